@@ -0,0 +1,389 @@
+#include "agentstore.h"
+
+#include "integrator.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+constexpr std::size_t kPermuteGrain = 16384;
+
+template <typename Fn>
+void forRange(ThreadPool *pool, std::size_t count, Fn &&fn)
+{
+    if (pool)
+    {
+        pool->parallelFor(count, kPermuteGrain, [&fn](std::size_t begin, std::size_t end, int) { fn(begin, end); });
+    }
+    else
+    {
+        fn(0, count);
+    }
+}
+
+template <typename T>
+void writeColumn(unsigned char *&out, const std::vector<T> &column)
+{
+    const std::size_t bytes = column.size() * sizeof(T);
+    if (bytes > 0)
+    {
+        std::memcpy(out, column.data(), bytes);
+    }
+    out += bytes;
+}
+
+template <typename T>
+void readColumn(const unsigned char *&in, std::vector<T> &column, std::size_t count)
+{
+    column.resize(count);
+    const std::size_t bytes = count * sizeof(T);
+    if (bytes > 0)
+    {
+        std::memcpy(column.data(), in, bytes);
+    }
+    in += bytes;
+}
+}
+
+AgentRef::AgentRef(const AgentStore *store, AgentIndex index) : m_store(store), m_index(index) {}
+
+bool AgentRef::isValid() const
+{
+    return m_store != nullptr && m_index < m_store->size();
+}
+
+AgentRef::operator bool() const
+{
+    return isValid();
+}
+
+AgentIndex AgentRef::index() const
+{
+    return m_index;
+}
+
+AgentId AgentRef::id() const
+{
+    return m_store->id(m_index);
+}
+
+ObjType AgentRef::type() const
+{
+    return m_store->type(m_index);
+}
+
+ObjStatus AgentRef::status() const
+{
+    return m_store->status(m_index);
+}
+
+QPointF AgentRef::pos() const
+{
+    return m_store->pos(m_index);
+}
+
+QPointF AgentRef::vel() const
+{
+    return m_store->vel(m_index);
+}
+
+bool AgentRef::isBusy() const
+{
+    return m_store->isBusy(m_index);
+}
+
+double AgentRef::speed() const
+{
+    return m_store->speed(m_index);
+}
+
+double AgentRef::biteRadius() const
+{
+    return m_store->biteRadius(m_index);
+}
+
+ObjState AgentRef::state() const
+{
+    ObjState s;
+    s.curStatus = status();
+    s.pos = pos();
+    s.vel = vel();
+    return s;
+}
+
+void AgentStore::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_nextX.clear();
+    m_nextY.clear();
+    m_vx.clear();
+    m_vy.clear();
+    m_id.clear();
+    m_type.clear();
+    m_status.clear();
+    m_busy.clear();
+    m_biteRadius.clear();
+    m_speed.clear();
+    m_slot.clear();
+    m_typeBegin.fill(0);
+    m_nextId = 0;
+}
+
+void AgentStore::reserve(std::size_t count)
+{
+    m_x.reserve(count);
+    m_y.reserve(count);
+    m_nextX.reserve(count);
+    m_nextY.reserve(count);
+    m_vx.reserve(count);
+    m_vy.reserve(count);
+    m_id.reserve(count);
+    m_type.reserve(count);
+    m_status.reserve(count);
+    m_busy.reserve(count);
+    m_biteRadius.reserve(count);
+    m_speed.reserve(count);
+    m_slot.reserve(count);
+}
+
+std::size_t AgentStore::size() const
+{
+    return m_type.size();
+}
+
+bool AgentStore::empty() const
+{
+    return m_type.empty();
+}
+
+AgentIndex AgentStore::add(ObjType type, const QPointF &pos, const QPointF &vel, double speed, double biteRadius)
+{
+    auto index = static_cast<AgentIndex>(m_type.size());
+    m_x.push_back(pos.x());
+    m_y.push_back(pos.y());
+    m_nextX.push_back(pos.x());
+    m_nextY.push_back(pos.y());
+    m_vx.push_back(vel.x());
+    m_vy.push_back(vel.y());
+    m_slot.push_back(index);
+    m_id.push_back(m_nextId++);
+    m_type.push_back(type);
+    m_status.push_back(ObjStatus::Idle);
+    m_busy.push_back(0);
+    m_biteRadius.push_back(biteRadius);
+    m_speed.push_back(speed);
+
+    // Новая строка проходит назад через диапазоны более поздних типов, по одному обмену на тип.
+    const auto target = static_cast<std::size_t>(type);
+    m_typeBegin[kObjTypeCount] = static_cast<AgentIndex>(m_type.size());
+    for (std::size_t t = kObjTypeCount - 1; t > target; --t)
+    {
+        const AgentIndex first = m_typeBegin[t];
+        swapRows(index, first);
+        index = first;
+        ++m_typeBegin[t];
+    }
+    return index;
+}
+
+AgentIndex AgentStore::changeType(AgentIndex i, ObjType type)
+{
+    auto from = static_cast<std::size_t>(m_type[i]);
+    const auto to = static_cast<std::size_t>(type);
+
+    while (from < to)
+    {
+        const AgentIndex last = m_typeBegin[from + 1] - 1;
+        swapRows(i, last);
+        i = last;
+        --m_typeBegin[from + 1];
+        ++from;
+    }
+    while (from > to)
+    {
+        const AgentIndex first = m_typeBegin[from];
+        swapRows(i, first);
+        i = first;
+        ++m_typeBegin[from];
+        --from;
+    }
+
+    m_type[i] = type;
+    return i;
+}
+
+void AgentStore::swapRows(AgentIndex a, AgentIndex b)
+{
+    if (a == b)
+    {
+        return;
+    }
+    std::swap(m_x[a], m_x[b]);
+    std::swap(m_y[a], m_y[b]);
+    std::swap(m_vx[a], m_vx[b]);
+    std::swap(m_vy[a], m_vy[b]);
+    std::swap(m_id[a], m_id[b]);
+    std::swap(m_type[a], m_type[b]);
+    std::swap(m_status[a], m_status[b]);
+    std::swap(m_busy[a], m_busy[b]);
+    std::swap(m_biteRadius[a], m_biteRadius[b]);
+    std::swap(m_speed[a], m_speed[b]);
+    m_slot[m_id[a]] = a;
+    m_slot[m_id[b]] = b;
+}
+
+AgentId AgentStore::nextId() const
+{
+    return m_nextId;
+}
+
+AgentRef AgentStore::at(AgentIndex i) const
+{
+    return AgentRef(this, i);
+}
+
+void AgentStore::clearBusy()
+{
+    std::fill(m_busy.begin(), m_busy.end(), 0);
+}
+
+std::size_t AgentStore::imageBytes(std::size_t count)
+{
+    return count * (6 * sizeof(double) + sizeof(AgentId) + sizeof(ObjType) + sizeof(ObjStatus) + sizeof(std::uint8_t));
+}
+
+void AgentStore::writeImage(unsigned char *out) const
+{
+    writeColumn(out, m_x);
+    writeColumn(out, m_y);
+    writeColumn(out, m_vx);
+    writeColumn(out, m_vy);
+    writeColumn(out, m_biteRadius);
+    writeColumn(out, m_speed);
+    writeColumn(out, m_id);
+    writeColumn(out, m_type);
+    writeColumn(out, m_status);
+    writeColumn(out, m_busy);
+}
+
+bool AgentStore::readImage(const unsigned char *in, std::size_t count,
+                           const std::array<AgentIndex, kObjTypeCount + 1> &typeBegin, AgentId nextId)
+{
+    // Агенты не удаляются, поэтому id строк — перестановка 0..count-1.
+    if (typeBegin[0] != 0 || typeBegin[kObjTypeCount] != count || nextId != count)
+    {
+        return false;
+    }
+    for (std::size_t t = 0; t < kObjTypeCount; ++t)
+    {
+        if (typeBegin[t] > typeBegin[t + 1])
+        {
+            return false;
+        }
+    }
+
+    readColumn(in, m_x, count);
+    readColumn(in, m_y, count);
+    readColumn(in, m_vx, count);
+    readColumn(in, m_vy, count);
+    readColumn(in, m_biteRadius, count);
+    readColumn(in, m_speed, count);
+    readColumn(in, m_id, count);
+    readColumn(in, m_type, count);
+    readColumn(in, m_status, count);
+    readColumn(in, m_busy, count);
+    m_nextX = m_x;
+    m_nextY = m_y;
+    m_typeBegin = typeBegin;
+    m_nextId = nextId;
+    m_slot.assign(count, kNoAgent);
+
+    for (std::size_t t = 0; t < kObjTypeCount; ++t)
+    {
+        for (AgentIndex i = typeBegin[t]; i < typeBegin[t + 1]; ++i)
+        {
+            if (static_cast<std::size_t>(m_type[i]) != t || static_cast<std::size_t>(m_status[i]) >= kObjStatusCount ||
+                m_id[i] >= nextId || m_slot[m_id[i]] != kNoAgent)
+            {
+                clear();
+                return false;
+            }
+            m_slot[m_id[i]] = i;
+        }
+    }
+    return true;
+}
+
+void AgentStore::integrate(double dt, const QRectF &bounds, std::size_t begin, std::size_t end)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+    const std::size_t count = end - begin;
+    integrator::advance({m_x.data() + begin, m_vx.data() + begin, m_nextX.data() + begin, bounds.left(), bounds.right()},
+                        count, dt);
+    integrator::advance({m_y.data() + begin, m_vy.data() + begin, m_nextY.data() + begin, bounds.top(), bounds.bottom()},
+                        count, dt);
+}
+
+template <typename T>
+void AgentStore::gatherColumn(std::vector<T> &column, std::vector<T> &scratch, const std::vector<AgentIndex> &order,
+                              ThreadPool *pool)
+{
+    const std::size_t n = order.size();
+    scratch.resize(n);
+    forRange(pool, n, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k)
+        {
+            scratch[k] = column[order[k]];
+        }
+    });
+    column.swap(scratch);
+}
+
+void AgentStore::permute(const std::vector<AgentIndex> &order, ThreadPool *pool)
+{
+    const std::size_t n = order.size();
+    if (n != m_id.size())
+    {
+        return;
+    }
+
+    // Координаты собираются во второй буфер и меняются с ним местами, остальные столбцы — через рабочие
+    // буферы своего типа.
+    forRange(pool, n, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k)
+        {
+            m_nextX[k] = m_x[order[k]];
+            m_nextY[k] = m_y[order[k]];
+        }
+    });
+    m_x.swap(m_nextX);
+    m_y.swap(m_nextY);
+
+    gatherColumn(m_vx, m_scratchReal, order, pool);
+    gatherColumn(m_vy, m_scratchReal, order, pool);
+    gatherColumn(m_biteRadius, m_scratchReal, order, pool);
+    gatherColumn(m_speed, m_scratchReal, order, pool);
+    gatherColumn(m_id, m_scratchId, order, pool);
+    gatherColumn(m_type, m_scratchType, order, pool);
+    gatherColumn(m_status, m_scratchStatus, order, pool);
+    gatherColumn(m_busy, m_scratchFlag, order, pool);
+
+    forRange(pool, n, [this](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k)
+        {
+            m_slot[m_id[k]] = static_cast<AgentIndex>(k);
+        }
+    });
+}
+
+void AgentStore::commitPositions()
+{
+    m_x.swap(m_nextX);
+    m_y.swap(m_nextY);
+}
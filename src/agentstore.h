@@ -0,0 +1,140 @@
+#pragma once
+
+#include <QPointF>
+#include <QRectF>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "worldobject.h"
+
+constexpr AgentIndex kNoAgent = std::numeric_limits<AgentIndex>::max();
+
+class AgentStore;
+class ThreadPool;
+
+// Лёгкая ссылка на агента в хранилище: не владеет данными и действительна до следующего шага мира.
+class AgentRef
+{
+public:
+    AgentRef() = default;
+    AgentRef(const AgentStore *store, AgentIndex index);
+
+    bool isValid() const;
+    explicit operator bool() const;
+
+    AgentIndex index() const;
+    AgentId id() const;
+    ObjType type() const;
+    ObjStatus status() const;
+    QPointF pos() const;
+    QPointF vel() const;
+    bool isBusy() const;
+    double speed() const;
+    double biteRadius() const;
+    ObjState state() const;
+
+private:
+    const AgentStore *m_store{nullptr};
+    AgentIndex m_index{kNoAgent};
+};
+
+// Хранилище агентов в виде структуры массивов: каждая характеристика — отдельный непрерывный столбец.
+// Строки разбиты на непрерывные диапазоны по типу в порядке ObjType: сначала люди, затем зомби.
+// Слот агента может меняться, id — нет.
+class AgentStore
+{
+public:
+    void clear();
+    void reserve(std::size_t count);
+    std::size_t size() const;
+    bool empty() const;
+
+    AgentIndex add(ObjType type, const QPointF &pos, const QPointF &vel, double speed, double biteRadius);
+    AgentId nextId() const;
+    AgentRef at(AgentIndex i) const;
+
+    AgentId id(AgentIndex i) const { return m_id[i]; }
+    // Текущий слот агента; меняется при смене типа, id — нет.
+    AgentIndex slotOf(AgentId id) const { return m_slot[id]; }
+    ObjType type(AgentIndex i) const { return m_type[i]; }
+    AgentIndex changeType(AgentIndex i, ObjType type);
+
+    AgentIndex typeBegin(ObjType type) const { return m_typeBegin[static_cast<std::size_t>(type)]; }
+    AgentIndex typeEnd(ObjType type) const { return m_typeBegin[static_cast<std::size_t>(type) + 1]; }
+
+    ObjStatus status(AgentIndex i) const { return m_status[i]; }
+    void setStatus(AgentIndex i, ObjStatus status) { m_status[i] = status; }
+
+    QPointF pos(AgentIndex i) const { return QPointF(m_x[i], m_y[i]); }
+    QPointF vel(AgentIndex i) const { return QPointF(m_vx[i], m_vy[i]); }
+    void setVel(AgentIndex i, const QPointF &vel)
+    {
+        m_vx[i] = vel.x();
+        m_vy[i] = vel.y();
+    }
+
+    bool isBusy(AgentIndex i) const { return m_busy[i] != 0; }
+    void setBusy(AgentIndex i, bool busy) { m_busy[i] = busy ? 1 : 0; }
+    void clearBusy();
+
+    double speed(AgentIndex i) const { return m_speed[i]; }
+    void setSpeed(AgentIndex i, double speed) { m_speed[i] = speed; }
+
+    double biteRadius(AgentIndex i) const { return m_biteRadius[i]; }
+    void setBiteRadius(AgentIndex i, double radius) { m_biteRadius[i] = radius; }
+
+    const std::vector<double> &xs() const { return m_x; }
+    const std::vector<double> &ys() const { return m_y; }
+    const std::vector<double> &vxs() const { return m_vx; }
+    const std::vector<double> &vys() const { return m_vy; }
+    const std::vector<ObjType> &types() const { return m_type; }
+    const std::vector<AgentId> &ids() const { return m_id; }
+
+    // Плоский образ для сохранения мира: столбцы подряд (сначала 8-байтовые, затем id, затем байтовые),
+    // без выравнивания. readImage проверяет, что типы строк согласованы с границами диапазонов.
+    static std::size_t imageBytes(std::size_t count);
+    void writeImage(unsigned char *out) const;
+    bool readImage(const unsigned char *in, std::size_t count,
+                   const std::array<AgentIndex, kObjTypeCount + 1> &typeBegin, AgentId nextId);
+    const std::array<AgentIndex, kObjTypeCount + 1> &typeBegins() const { return m_typeBegin; }
+
+    // Переставляет строки: новая строка k — прежняя строка order[k]. Перестановка не должна выводить
+    // строки из диапазонов их типов; id и слоты через slotOf остаются согласованы. Второй буфер
+    // позиций используется как рабочий, поэтому вызывать можно только между шагами.
+    void permute(const std::vector<AgentIndex> &order, ThreadPool *pool);
+
+    // Пишет новые позиции строк [begin, end) во второй буфер, текущие позиции не трогает.
+    void integrate(double dt, const QRectF &bounds, std::size_t begin, std::size_t end);
+    void commitPositions();
+
+private:
+    void swapRows(AgentIndex a, AgentIndex b);
+    template <typename T>
+    static void gatherColumn(std::vector<T> &column, std::vector<T> &scratch, const std::vector<AgentIndex> &order,
+                             ThreadPool *pool);
+
+    std::array<AgentIndex, kObjTypeCount + 1> m_typeBegin{};
+    AgentId m_nextId{0};
+    // Обратный индекс id -> слот, поддерживается при каждом обмене строк.
+    std::vector<AgentIndex> m_slot;
+    // Рабочие буферы permute по типу столбца: столбец собирается в буфер и меняется с ним местами.
+    std::vector<double> m_scratchReal;
+    std::vector<AgentId> m_scratchId;
+    std::vector<ObjType> m_scratchType;
+    std::vector<ObjStatus> m_scratchStatus;
+    std::vector<std::uint8_t> m_scratchFlag;
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_nextX;
+    std::vector<double> m_nextY;
+    std::vector<double> m_vx;
+    std::vector<double> m_vy;
+    std::vector<AgentId> m_id;
+    std::vector<ObjType> m_type;
+    std::vector<ObjStatus> m_status;
+    std::vector<std::uint8_t> m_busy;
+    std::vector<double> m_biteRadius;
+    std::vector<double> m_speed;
+};
@@ -0,0 +1,49 @@
+#include "bitebuffer.h"
+
+void BiteBuffer::resize(std::size_t agentCount)
+{
+    clear();
+    m_seen.assign((agentCount + 63) / 64, 0);
+    m_victims.reserve(agentCount);
+}
+
+bool BiteBuffer::record(AgentIndex victim)
+{
+    const std::size_t word = victim >> 6;
+    if (word >= m_seen.size())
+    {
+        m_seen.resize(word + 1, 0);
+    }
+    const std::uint64_t bit = std::uint64_t{1} << (victim & 63);
+    if ((m_seen[word] & bit) != 0)
+    {
+        return false;
+    }
+    m_seen[word] |= bit;
+    m_victims.push_back(victim);
+    return true;
+}
+
+const std::vector<AgentIndex> &BiteBuffer::victims() const
+{
+    return m_victims;
+}
+
+std::size_t BiteBuffer::size() const
+{
+    return m_victims.size();
+}
+
+bool BiteBuffer::empty() const
+{
+    return m_victims.empty();
+}
+
+void BiteBuffer::clear()
+{
+    for (AgentIndex victim : m_victims)
+    {
+        m_seen[victim >> 6] = 0;
+    }
+    m_victims.clear();
+}
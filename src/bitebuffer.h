@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "worldobject.h"
+
+// Укусы за шаг: список жертв в порядке регистрации и битсет по слоту агента для отсева повторов.
+class BiteBuffer
+{
+public:
+    void resize(std::size_t agentCount);
+
+    bool record(AgentIndex victim);
+
+    const std::vector<AgentIndex> &victims() const;
+    std::size_t size() const;
+    bool empty() const;
+
+    void clear();
+
+private:
+    std::vector<AgentIndex> m_victims;
+    std::vector<std::uint64_t> m_seen;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Счётный генератор на основе SplitMix64: значение — чистая функция от (seed, id агента, шаг, номер выборки).
+// Общего состояния нет, поэтому потоки не синхронизируются, а порядок обхода агентов не влияет на результат.
+class CounterRng
+{
+public:
+    CounterRng(std::uint64_t seed, std::uint64_t agentId, std::uint64_t step)
+        : m_key(keyFor(seed, agentId, step))
+    {
+    }
+
+    std::uint64_t nextU64() { return mix(m_key + kGolden * ++m_counter); }
+
+    // Равномерно в [0, 1), 53 бита мантиссы.
+    double nextDouble() { return toUnit(nextU64()); }
+
+    // Равномерно в [-1, 1).
+    double nextSigned() { return nextDouble() * 2.0 - 1.0; }
+
+    static std::uint64_t mix(std::uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    static std::uint64_t keyFor(std::uint64_t seed, std::uint64_t agentId, std::uint64_t step)
+    {
+        return mix(mix(seed + kGolden * (agentId + 1)) ^ (step * 0xD1B54A32D192ED03ULL));
+    }
+
+    static double toUnit(std::uint64_t bits) { return static_cast<double>(bits >> 11) * 0x1.0p-53; }
+
+    // Пакетная выборка: out[k] = k-е значение потока ids[k] на шаге step. Тело цикла без ветвлений
+    // и без зависимостей между итерациями, компилятор разворачивает его в векторные инструкции.
+    static void fillUnit(std::uint64_t seed, std::uint64_t step, std::uint64_t counter, const std::uint32_t *ids,
+                         std::size_t count, double *out)
+    {
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            out[k] = toUnit(mix(keyFor(seed, ids[k], step) + kGolden * counter));
+        }
+    }
+
+private:
+    static constexpr std::uint64_t kGolden = 0x9E3779B97F4A7C15ULL;
+
+    std::uint64_t m_key;
+    std::uint64_t m_counter{0};
+};
@@ -0,0 +1,107 @@
+#include "densitygrid.h"
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr std::size_t kBinGrain = 16384;
+constexpr std::size_t kMergeGrain = 4096;
+
+// Номер ячейки по дробной координате в ячейках. Прижимается ещё в double: приведение к int значения
+// вне диапазона int или NaN — неопределённое поведение. NaN уходит в нулевую ячейку.
+int clampCell(double c, int last)
+{
+    if (!(c >= 0.0))
+    {
+        return 0;
+    }
+    return c >= last ? last : static_cast<int>(c);
+}
+}
+
+void DensityGrid::configure(const QRectF &bounds, int columns, int rows)
+{
+    columns = std::max(columns, 1);
+    rows = std::max(rows, 1);
+    if (bounds == m_bounds && columns == m_columns && rows == m_rows)
+    {
+        return;
+    }
+    m_bounds = bounds;
+    m_columns = columns;
+    m_rows = rows;
+    m_scaleX = columns / std::max(bounds.width(), 1e-9);
+    m_scaleY = rows / std::max(bounds.height(), 1e-9);
+    m_partials.clear();
+}
+
+const QRectF &DensityGrid::bounds() const
+{
+    return m_bounds;
+}
+
+int DensityGrid::columns() const
+{
+    return m_columns;
+}
+
+int DensityGrid::rows() const
+{
+    return m_rows;
+}
+
+std::size_t DensityGrid::cellCount() const
+{
+    return static_cast<std::size_t>(m_columns) * m_rows;
+}
+
+void DensityGrid::binRange(const double *xs, const double *ys, std::size_t begin, std::size_t end,
+                           std::uint32_t *out) const
+{
+    const double left = m_bounds.left();
+    const double top = m_bounds.top();
+    const int lastCol = m_columns - 1;
+    const int lastRow = m_rows - 1;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        // Точки на границе мира и за ней прижимаются к крайним ячейкам.
+        const int col = clampCell((xs[i] - left) * m_scaleX, lastCol);
+        const int row = clampCell((ys[i] - top) * m_scaleY, lastRow);
+        ++out[static_cast<std::size_t>(row) * m_columns + col];
+    }
+}
+
+void DensityGrid::bin(const double *xs, const double *ys, std::size_t count, std::uint32_t *out, ThreadPool *pool)
+{
+    const std::size_t cells = cellCount();
+    if (pool == nullptr || pool->threadCount() <= 1 || count < 2 * kBinGrain)
+    {
+        std::fill(out, out + cells, 0u);
+        binRange(xs, ys, 0, count, out);
+        return;
+    }
+
+    const auto workers = static_cast<std::size_t>(pool->threadCount());
+    if (m_partials.size() != workers)
+    {
+        m_partials.assign(workers, std::vector<std::uint32_t>(cells, 0u));
+    }
+
+    pool->parallelFor(count, kBinGrain, [this, xs, ys](std::size_t begin, std::size_t end, int worker) {
+        binRange(xs, ys, begin, end, m_partials[static_cast<std::size_t>(worker)].data());
+    });
+
+    pool->parallelFor(cells, kMergeGrain, [this, out](std::size_t begin, std::size_t end, int) {
+        std::fill(out + begin, out + end, 0u);
+        for (std::vector<std::uint32_t> &partial : m_partials)
+        {
+            for (std::size_t c = begin; c < end; ++c)
+            {
+                out[c] += partial[c];
+                partial[c] = 0;
+            }
+        }
+    });
+}
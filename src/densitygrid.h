@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QRectF>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Двумерная гистограмма фиксированного разрешения над прямоугольником мира. Точки раскладываются
+// по ячейкам напрямую из столбцов координат; с пулом каждый исполнитель копит свою частичную
+// гистограмму, которые затем складываются по диапазонам ячеек.
+class DensityGrid
+{
+public:
+    void configure(const QRectF &bounds, int columns, int rows);
+
+    const QRectF &bounds() const;
+    int columns() const;
+    int rows() const;
+    std::size_t cellCount() const;
+
+    // out должен вмещать cellCount() счётчиков; прежнее содержимое затирается.
+    void bin(const double *xs, const double *ys, std::size_t count, std::uint32_t *out, ThreadPool *pool);
+
+private:
+    void binRange(const double *xs, const double *ys, std::size_t begin, std::size_t end, std::uint32_t *out) const;
+
+    QRectF m_bounds;
+    int m_columns{1};
+    int m_rows{1};
+    double m_scaleX{1.0};
+    double m_scaleY{1.0};
+
+    // Частичные гистограммы исполнителей, обнуляются при сведении.
+    std::vector<std::vector<std::uint32_t>> m_partials;
+};
@@ -0,0 +1,195 @@
+#include "ensemble.h"
+
+#include "counterrng.h"
+#include "streamingstats.h"
+#include "threadpool.h"
+#include "world.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+struct StepAccumulator
+{
+    StepAccumulator(double lowQ, double highQ) : low(lowQ), median(0.5), high(highQ) {}
+
+    void add(double x)
+    {
+        stats.add(x);
+        low.add(x);
+        median.add(x);
+        high.add(x);
+    }
+
+    RunningStats stats;
+    P2Quantile low;
+    P2Quantile median;
+    P2Quantile high;
+};
+
+void fillBand(const std::vector<StepAccumulator> &acc, EnsembleBand &band)
+{
+    const int n = static_cast<int>(acc.size());
+    band.mean.resize(n);
+    band.stddev.resize(n);
+    band.low.resize(n);
+    band.median.resize(n);
+    band.high.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        const StepAccumulator &a = acc[static_cast<std::size_t>(i)];
+        band.mean[i] = a.stats.mean();
+        band.stddev[i] = a.stats.stddev();
+        band.low[i] = a.low.value();
+        band.median[i] = a.median.value();
+        band.high[i] = a.high.value();
+    }
+}
+}
+
+EnsembleRunner::EnsembleRunner(const EnsembleConfig &config) : m_config(config) {}
+
+std::uint64_t EnsembleRunner::runSeed(std::uint64_t seed, int run)
+{
+    return CounterRng::mix(seed + 0x9E3779B97F4A7C15ULL * static_cast<std::uint64_t>(run + 1));
+}
+
+EnsembleResult EnsembleRunner::run(const ProgressFn &progress) const
+{
+    const EnsembleConfig cfg = m_config;
+    const auto samples = static_cast<std::size_t>(std::max(cfg.steps, 0)) + 1;
+
+    std::vector<StepAccumulator> humans(samples, StepAccumulator(cfg.lowQuantile, cfg.highQuantile));
+    std::vector<StepAccumulator> zombies(samples, StepAccumulator(cfg.lowQuantile, cfg.highQuantile));
+    std::vector<double> time(samples, 0.0);
+
+    // Прогоны заканчиваются в любом порядке. Готовый ряд ждёт в своей ячейке, пока не свернутся все
+    // прогоны с меньшими номерами; в памяти остаются только ряды, обогнавшие самый медленный прогон.
+    struct RunSeries
+    {
+        std::vector<int> humans;
+        std::vector<int> zombies;
+        bool done{false};
+    };
+    const auto runs = static_cast<std::size_t>(std::max(cfg.runs, 0));
+    std::vector<RunSeries> pending(runs);
+    std::size_t nextFold = 0;
+    std::mutex mutex;
+    int finished = 0;
+
+    const int threads = cfg.threads > 0 ? cfg.threads : ThreadPool::hardwareThreads();
+    ThreadPool pool(std::min(threads, std::max(cfg.runs, 1)));
+
+    pool.runTasks(runs, [&](std::size_t task, int) {
+        World world;
+        world.setDefaultBiteRadius(cfg.biteRadius);
+        world.setIncubationTime(cfg.incubation);
+        world.setPerceptionRadius(cfg.perception);
+        world.setPursuitMode(cfg.pursuit);
+        world.setGridCellSize(cfg.cellSize);
+        world.reset(cfg.humans, cfg.zombies, runSeed(cfg.seed, static_cast<int>(task)));
+
+        std::vector<int> h(samples);
+        std::vector<int> z(samples);
+        std::vector<double> t(samples);
+        h[0] = world.humanCount();
+        z[0] = world.zombieCount();
+        t[0] = world.time();
+        for (std::size_t s = 1; s < samples; ++s)
+        {
+            world.step(cfg.dt);
+            h[s] = world.humanCount();
+            z[s] = world.zombieCount();
+            t[s] = world.time();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        pending[task].humans.swap(h);
+        pending[task].zombies.swap(z);
+        pending[task].done = true;
+        for (; nextFold < runs && pending[nextFold].done; ++nextFold)
+        {
+            RunSeries &series = pending[nextFold];
+            for (std::size_t s = 0; s < samples; ++s)
+            {
+                humans[s].add(series.humans[s]);
+                zombies[s].add(series.zombies[s]);
+            }
+            std::vector<int>().swap(series.humans);
+            std::vector<int>().swap(series.zombies);
+        }
+        time = t;
+        ++finished;
+        if (progress)
+        {
+            progress(finished, cfg.runs);
+        }
+    });
+
+    EnsembleResult result;
+    result.runs = cfg.runs;
+    result.lowQuantile = cfg.lowQuantile;
+    result.highQuantile = cfg.highQuantile;
+    result.time = QVector<double>(time.begin(), time.end());
+    fillBand(humans, result.humans);
+    fillBand(zombies, result.zombies);
+    return result;
+}
+
+ForkRunner::ForkRunner(const World &origin, int steps, int threads)
+    : m_image(origin.stateImage()), m_steps(std::max(steps, 0)), m_threads(threads)
+{
+}
+
+QVector<ForkResult> ForkRunner::run(const QVector<ForkBranch> &branches, const ProgressFn &progress) const
+{
+    const int count = branches.size();
+    const auto samples = static_cast<std::size_t>(m_steps) + 1;
+    // Каждая задача пишет только в свой элемент, поэтому результаты не требуют блокировки.
+    std::vector<ForkResult> results(static_cast<std::size_t>(count));
+
+    std::mutex mutex;
+    int finished = 0;
+
+    const int threads = m_threads > 0 ? m_threads : ThreadPool::hardwareThreads();
+    ThreadPool pool(std::min(threads, std::max(count, 1)));
+
+    pool.runTasks(static_cast<std::size_t>(count), [&](std::size_t task, int) {
+        ForkResult &r = results[task];
+        r.branch = branches[static_cast<int>(task)];
+
+        World world;
+        if (!world.restoreState(m_image))
+        {
+            return;
+        }
+        r.restored = true;
+        world.applyBiteRadius(r.branch.biteRadius);
+
+        r.time.resize(static_cast<int>(samples));
+        r.humans.resize(static_cast<int>(samples));
+        r.zombies.resize(static_cast<int>(samples));
+        r.time[0] = world.time();
+        r.humans[0] = world.humanCount();
+        r.zombies[0] = world.zombieCount();
+        for (std::size_t s = 1; s < samples; ++s)
+        {
+            world.step(r.branch.dt);
+            const int i = static_cast<int>(s);
+            r.time[i] = world.time();
+            r.humans[i] = world.humanCount();
+            r.zombies[i] = world.zombieCount();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ++finished;
+        if (progress)
+        {
+            progress(finished, count);
+        }
+    });
+
+    return QVector<ForkResult>(results.begin(), results.end());
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <QByteArray>
+#include <QVector>
+#include <cstdint>
+#include <functional>
+
+#include "world.h"
+
+struct EnsembleConfig
+{
+    int runs{32};
+    int humans{40};
+    int zombies{5};
+    double dt{0.1};
+    double biteRadius{6.0};
+    double incubation{0.0};
+    double perception{0.0};
+    World::PursuitMode pursuit{World::PursuitMode::Nearest};
+    // Размер ячейки сетки соседей; 0 — по плотности агентов.
+    double cellSize{0.0};
+    int steps{500};
+    std::uint64_t seed{1};
+    int threads{0};
+    double lowQuantile{0.05};
+    double highQuantile{0.95};
+};
+
+struct EnsembleBand
+{
+    QVector<double> mean;
+    QVector<double> stddev;
+    QVector<double> low;
+    QVector<double> median;
+    QVector<double> high;
+};
+
+struct EnsembleResult
+{
+    int runs{0};
+    double lowQuantile{0.0};
+    double highQuantile{0.0};
+    QVector<double> time;
+    EnsembleBand humans;
+    EnsembleBand zombies;
+};
+
+// Монте-Карло: K независимых миров с разными seed на пуле потоков. Ряды численности сводятся
+// потоковыми накопителями (Уэлфорд для среднего и дисперсии, P² для квантилей), поэтому память
+// растёт с числом шагов, но не с K. P² зависит от порядка поступления, поэтому ряды сворачиваются
+// в порядке номеров прогонов, а не завершения: при том же seed результат не зависит от числа потоков.
+// До свёртки держатся только ряды прогонов, обогнавших самый медленный из ещё идущих.
+class EnsembleRunner
+{
+public:
+    using ProgressFn = std::function<void(int finished, int total)>;
+
+    explicit EnsembleRunner(const EnsembleConfig &config);
+
+    EnsembleResult run(const ProgressFn &progress = ProgressFn()) const;
+
+    static std::uint64_t runSeed(std::uint64_t seed, int run);
+
+private:
+    EnsembleConfig m_config;
+};
+
+// Ветвь развилки: параметры, с которыми продолжается копия мира.
+struct ForkBranch
+{
+    double biteRadius{6.0};
+    double dt{0.1};
+};
+
+struct ForkResult
+{
+    ForkBranch branch;
+    // false — образ не восстановился, ряды ветви пустые.
+    bool restored{false};
+    QVector<double> time;
+    QVector<int> humans;
+    QVector<int> zombies;
+};
+
+// Развилка: образ состояния мира снимается один раз, каждая ветвь восстанавливает из него свою
+// копию и шагает дальше со своими параметрами. Ветви идут параллельно на пуле потоков; счётный
+// генератор продолжает ряд исходного мира, поэтому ветви с одинаковыми параметрами совпадают.
+class ForkRunner
+{
+public:
+    using ProgressFn = std::function<void(int finished, int total)>;
+
+    ForkRunner(const World &origin, int steps, int threads = 0);
+
+    QVector<ForkResult> run(const QVector<ForkBranch> &branches, const ProgressFn &progress = ProgressFn()) const;
+
+private:
+    QByteArray m_image;
+    int m_steps{0};
+    int m_threads{0};
+};
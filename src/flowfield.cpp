@@ -0,0 +1,221 @@
+#include "flowfield.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr int kMaxCellsPerAxis = 2048;
+constexpr double kAutoSourcesPerCell = 1.0;
+
+// Номер ячейки по дробной координате в ячейках. Прижимается ещё в double: приведение к int значения
+// вне диапазона int или NaN — неопределённое поведение. NaN уходит в нулевую ячейку.
+int clampCell(double c, int last)
+{
+    if (!(c >= 0.0))
+    {
+        return 0;
+    }
+    return c >= last ? last : static_cast<int>(c);
+}
+}
+
+void FlowField::setCellSize(double size)
+{
+    if (size >= 0.0)
+    {
+        m_cellSize = size;
+    }
+}
+
+double FlowField::cellSize() const
+{
+    return m_cellSize;
+}
+
+int FlowField::columns() const
+{
+    return m_cols;
+}
+
+int FlowField::rows() const
+{
+    return m_rows;
+}
+
+std::size_t FlowField::cellIndex(double x, double y) const
+{
+    // Точки на границе мира и за ней прижимаются к крайним ячейкам.
+    const int col = clampCell((x - m_bounds.left()) * m_scaleX, m_cols - 1);
+    const int row = clampCell((y - m_bounds.top()) * m_scaleY, m_rows - 1);
+    return static_cast<std::size_t>(row) * m_cols + col;
+}
+
+void FlowField::cellCenter(std::size_t cell, double &x, double &y) const
+{
+    x = m_bounds.left() + (static_cast<double>(cell % m_cols) + 0.5) * m_cellW;
+    y = m_bounds.top() + (static_cast<double>(cell / m_cols) + 0.5) * m_cellH;
+}
+
+void FlowField::build(const QRectF &bounds, const double *xs, const double *ys, const std::uint32_t *sources,
+                      std::size_t count)
+{
+    m_bounds = bounds;
+
+    const double width = std::max(bounds.width(), 1e-9);
+    const double height = std::max(bounds.height(), 1e-9);
+    double cell = m_cellSize;
+    if (cell <= 0.0)
+    {
+        const double n = static_cast<double>(std::max<std::size_t>(count, 1));
+        cell = std::sqrt(width * height * kAutoSourcesPerCell / n);
+    }
+    m_cols = std::clamp(static_cast<int>(std::ceil(width / cell)), 1, kMaxCellsPerAxis);
+    m_rows = std::clamp(static_cast<int>(std::ceil(height / cell)), 1, kMaxCellsPerAxis);
+    m_scaleX = m_cols / width;
+    m_scaleY = m_rows / height;
+    m_cellW = width / m_cols;
+    m_cellH = height / m_rows;
+
+    const std::size_t cellCount = static_cast<std::size_t>(m_cols) * m_rows;
+    m_source.assign(cellCount, kNoSource);
+    m_parent.assign(cellCount, kNoSource);
+    m_distance.assign(cellCount, kNoSource);
+    m_seedDist.resize(cellCount);
+    m_queue.clear();
+    m_queue.reserve(cellCount);
+
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        const std::uint32_t i = sources[k];
+        const std::size_t c = cellIndex(xs[i], ys[i]);
+        double cx;
+        double cy;
+        cellCenter(c, cx, cy);
+        const double d = std::hypot(xs[i] - cx, ys[i] - cy);
+        if (m_source[c] == kNoSource)
+        {
+            m_source[c] = i;
+            m_parent[c] = static_cast<std::uint32_t>(c);
+            m_distance[c] = 0;
+            m_seedDist[c] = d;
+            m_queue.push_back(static_cast<std::uint32_t>(c));
+        }
+        else if (d < m_seedDist[c])
+        {
+            m_source[c] = i;
+            m_seedDist[c] = d;
+        }
+    }
+
+    // Очередь уже содержит все ячейки-источники: волна расходится от них одновременно, каждая ячейка
+    // встаёт в очередь один раз. Если до ячейки на одном шаге волны дошли разные источники, остаётся
+    // ближайший к её центру — так границы областей ближе к евклидовым, чем у чистого BFS. Родитель
+    // меняется вместе с источником, поэтому у ячейки и её родителя источник всегда общий: к моменту
+    // выхода ячейки из очереди все ячейки прошлого шага волны уже обработаны.
+    const auto centerDistance = [&](std::size_t n, std::uint32_t s) {
+        double cx;
+        double cy;
+        cellCenter(n, cx, cy);
+        return std::hypot(xs[s] - cx, ys[s] - cy);
+    };
+    for (std::size_t head = 0; head < m_queue.size(); ++head)
+    {
+        const std::uint32_t c = m_queue[head];
+        const int col = static_cast<int>(c % m_cols);
+        const int row = static_cast<int>(c / m_cols);
+        const std::uint32_t next = m_distance[c] + 1;
+        for (int dr = -1; dr <= 1; ++dr)
+        {
+            const int r = row + dr;
+            if (r < 0 || r >= m_rows)
+            {
+                continue;
+            }
+            for (int dc = -1; dc <= 1; ++dc)
+            {
+                const int k = col + dc;
+                if (k < 0 || k >= m_cols)
+                {
+                    continue;
+                }
+                const std::size_t n = static_cast<std::size_t>(r) * m_cols + k;
+                if (m_distance[n] == kNoSource)
+                {
+                    m_distance[n] = next;
+                    m_source[n] = m_source[c];
+                    m_parent[n] = c;
+                    m_seedDist[n] = centerDistance(n, m_source[c]);
+                    m_queue.push_back(static_cast<std::uint32_t>(n));
+                }
+                else if (m_distance[n] == next && m_source[n] != m_source[c])
+                {
+                    const double d = centerDistance(n, m_source[c]);
+                    if (d < m_seedDist[n])
+                    {
+                        m_source[n] = m_source[c];
+                        m_parent[n] = c;
+                        m_seedDist[n] = d;
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::uint32_t FlowField::source(double x, double y) const
+{
+    return m_source.empty() ? kNoSource : m_source[cellIndex(x, y)];
+}
+
+std::uint32_t FlowField::nearestSource(double x, double y, const double *xs, const double *ys) const
+{
+    if (m_source.empty())
+    {
+        return kNoSource;
+    }
+    const std::size_t c = cellIndex(x, y);
+    const int col = static_cast<int>(c % m_cols);
+    const int row = static_cast<int>(c / m_cols);
+
+    std::uint32_t best = kNoSource;
+    double bestDist = 0.0;
+    for (int r = std::max(row - 1, 0); r <= std::min(row + 1, m_rows - 1); ++r)
+    {
+        for (int k = std::max(col - 1, 0); k <= std::min(col + 1, m_cols - 1); ++k)
+        {
+            const std::uint32_t s = m_source[static_cast<std::size_t>(r) * m_cols + k];
+            if (s == kNoSource || s == best)
+            {
+                continue;
+            }
+            const double d = std::hypot(xs[s] - x, ys[s] - y);
+            if (best == kNoSource || d < bestDist || (d == bestDist && s < best))
+            {
+                best = s;
+                bestDist = d;
+            }
+        }
+    }
+    return best;
+}
+
+std::uint32_t FlowField::distance(double x, double y) const
+{
+    return m_distance.empty() ? kNoSource : m_distance[cellIndex(x, y)];
+}
+
+bool FlowField::waypoint(double x, double y, double &wx, double &wy) const
+{
+    if (m_source.empty())
+    {
+        return false;
+    }
+    const std::uint32_t parent = m_parent[cellIndex(x, y)];
+    if (parent == kNoSource)
+    {
+        return false;
+    }
+    cellCenter(parent, wx, wy);
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QRectF>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Поле преследования над прямоугольником мира: многоисточниковый BFS (8 соседей) от ячеек с людьми
+// раздаёт каждой ячейке ближайший по волне источник и родителя — соседнюю ячейку, из которой пришла
+// волна, то есть следующий шаг кратчайшего по ячейкам пути к источнику. Построение — O(ячеек +
+// источников), ответ для точки — O(1). Источник ячейки — приближение ближайшего человека с точностью
+// до размера ячейки.
+class FlowField
+{
+public:
+    static constexpr std::uint32_t kNoSource = std::numeric_limits<std::uint32_t>::max();
+
+    // 0 — размер ячейки подбирается при построении по числу источников (около одного на ячейку).
+    void setCellSize(double size);
+    double cellSize() const;
+
+    // Источники — строки sources[0..count) столбцов координат по возрастанию; в ячейке с несколькими
+    // источниками остаётся ближайший к её центру (при равенстве — меньший слот).
+    void build(const QRectF &bounds, const double *xs, const double *ys, const std::uint32_t *sources,
+               std::size_t count);
+
+    int columns() const;
+    int rows() const;
+
+    std::uint32_t source(double x, double y) const;
+    // Ближайший к точке из источников её ячейки и восьми соседних (xs/ys — те же столбцы, что при
+    // построении). Всё ещё O(1), но заметно точнее одного source() у границ областей.
+    std::uint32_t nearestSource(double x, double y, const double *xs, const double *ys) const;
+    // Число шагов волны от ячейки источника; kNoSource, если источников нет.
+    std::uint32_t distance(double x, double y) const;
+    // Центр ячейки-родителя: куда идти из точки, чтобы по полю приблизиться к источнику её ячейки.
+    // Для ячейки-источника — её собственный центр; false, если источников нет.
+    bool waypoint(double x, double y, double &wx, double &wy) const;
+
+private:
+    std::size_t cellIndex(double x, double y) const;
+    void cellCenter(std::size_t cell, double &x, double &y) const;
+
+    double m_cellSize{0.0};
+    QRectF m_bounds;
+    int m_cols{0};
+    int m_rows{0};
+    double m_scaleX{1.0};
+    double m_scaleY{1.0};
+    double m_cellW{1.0};
+    double m_cellH{1.0};
+
+    std::vector<std::uint32_t> m_source;
+    std::vector<std::uint32_t> m_parent;
+    std::vector<std::uint32_t> m_distance;
+    std::vector<double> m_seedDist;
+    std::vector<std::uint32_t> m_queue;
+};
@@ -1,35 +1,95 @@
 #include "human.h"
 
-#include <QRandomGenerator>
+#include "agentstore.h"
+#include "counterrng.h"
+#include "world.h"
+
 #include <QtMath>
 
 Human::Human(QObject *parent) : WorldObject(ObjType::Human, parent) {}
 
-void Human::updateState(World &world, double dt)
+double Human::defaultSpeed() const
+{
+    return 12.0;
+}
+
+bool Human::flee(StepContext &ctx, AgentIndex index, double speed)
+{
+    const double perception = ctx.world.perceptionRadius();
+    if (perception <= 0.0)
+    {
+        return false;
+    }
+
+    // Каждый зомби в обзоре отталкивает с силой 1/d: ближние перевешивают дальних.
+    AgentStore &agents = ctx.agents;
+    const double *xs = agents.xs().data();
+    const double *ys = agents.ys().data();
+    const double x = xs[index];
+    const double y = ys[index];
+    double awayX = 0.0;
+    double awayY = 0.0;
+    ctx.world.forEachInRadius(QPointF(x, y), perception, ObjType::Zombie, [&](AgentIndex zombie) {
+        const double dx = x - xs[zombie];
+        const double dy = y - ys[zombie];
+        const double d2 = dx * dx + dy * dy;
+        if (d2 > 1e-12)
+        {
+            awayX += dx / d2;
+            awayY += dy / d2;
+        }
+    });
+
+    const double len = std::hypot(awayX, awayY);
+    if (!(len > 1e-12))
+    {
+        return false;
+    }
+    const double scale = speed / len;
+    agents.setVel(index, QPointF(awayX * scale, awayY * scale));
+    return true;
+}
+
+void Human::updateState(StepContext &ctx, AgentIndex index)
 {
-    Q_UNUSED(world)
-    Q_UNUSED(dt)
+    AgentStore &agents = ctx.agents;
+    // Заражённый ведёт себя как человек, но статус Infected сохраняет до превращения.
+    if (agents.status(index) != ObjStatus::Infected)
+    {
+        ctx.setStatus(index, ObjStatus::Moving);
+    }
 
-    m_state.curStatus = ObjStatus::Moving;
+    const double speed = agents.speed(index);
+    if (flee(ctx, index, speed))
+    {
+        return;
+    }
 
     const double jitter = 4.0;
-    auto *rng = QRandomGenerator::global();
-    const double dx = (rng->generateDouble() * 2.0 - 1.0) * jitter;
-    const double dy = (rng->generateDouble() * 2.0 - 1.0) * jitter;
+    CounterRng rng(ctx.seed, agents.id(index), ctx.step);
+    const double dx = rng.nextSigned() * jitter;
+    const double dy = rng.nextSigned() * jitter;
 
-    QPointF vel = m_state.vel + QPointF(dx, dy);
+    QPointF vel = agents.vel(index) + QPointF(dx, dy);
     const double len = std::hypot(vel.x(), vel.y());
     if (len > 1e-3)
     {
-        const double scale = m_speed / len;
+        const double scale = speed / len;
         vel.setX(vel.x() * scale);
         vel.setY(vel.y() * scale);
     }
     else
     {
-        vel = QPointF((rng->generateDouble() * 2.0 - 1.0) * m_speed,
-                      (rng->generateDouble() * 2.0 - 1.0) * m_speed);
+        vel = QPointF(rng.nextSigned() * speed, rng.nextSigned() * speed);
     }
 
-    m_state.vel = vel;
+    agents.setVel(index, vel);
+}
+
+void Human::updateRange(StepContext &ctx, AgentIndex begin, AgentIndex end)
+{
+    for (AgentIndex i = begin; i < end; ++i)
+    {
+        updateState(ctx, i);
+    }
 }
@@ -2,14 +2,19 @@
 
 #include "worldobject.h"
 
-class Human : public WorldObject
+class Human final : public WorldObject
 {
     Q_OBJECT
 public:
     explicit Human(QObject *parent = nullptr);
 
-    void updateState(World &world, double dt) override;
+    double defaultSpeed() const override;
+
+    void updateState(StepContext &ctx, AgentIndex index);
+    // Строки [begin, end) — агенты этого типа.
+    void updateRange(StepContext &ctx, AgentIndex begin, AgentIndex end);
 
 private:
-    double m_speed{12.0};
+    // Разворачивает человека от зомби в радиусе обзора мира; false — угрозы нет, человек бродит.
+    bool flee(StepContext &ctx, AgentIndex index, double speed);
 };
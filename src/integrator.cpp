@@ -0,0 +1,152 @@
+#include "integrator.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define ZOMBIE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace integrator
+{
+namespace
+{
+using Kernel = void (*)(const Axis &, std::size_t, std::size_t, double);
+
+void advanceScalar(const Axis &a, std::size_t begin, std::size_t end, double dt)
+{
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        double next = a.pos[i] + a.vel[i] * dt;
+        if (next < a.lo)
+        {
+            next = a.lo;
+            a.vel[i] = -a.vel[i];
+        }
+        else if (next > a.hi)
+        {
+            next = a.hi;
+            a.vel[i] = -a.vel[i];
+        }
+        a.out[i] = next;
+    }
+}
+
+#if defined(ZOMBIE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ZOMBIE_HAS_SIMD 1
+
+// Умножение и сложение — отдельные инструкции (без FMA), чтобы округление совпадало со скалярной версией.
+// Граница подставляется по маскам сравнения, как ветвления скалярной версии (а не через min/max, у которых
+// NaN и -0.0 зависят от порядка операндов), поэтому NaN и -0.0 проходят так же.
+__attribute__((target("sse2"))) void advanceSse2(const Axis &a, std::size_t begin, std::size_t end, double dt)
+{
+    const __m128d vdt = _mm_set1_pd(dt);
+    const __m128d lo = _mm_set1_pd(a.lo);
+    const __m128d hi = _mm_set1_pd(a.hi);
+    const __m128d sign = _mm_set1_pd(-0.0);
+
+    std::size_t i = begin;
+    for (; i + 2 <= end; i += 2)
+    {
+        const __m128d p = _mm_loadu_pd(a.pos + i);
+        const __m128d v = _mm_loadu_pd(a.vel + i);
+        const __m128d next = _mm_add_pd(p, _mm_mul_pd(v, vdt));
+        const __m128d below = _mm_cmplt_pd(next, lo);
+        const __m128d above = _mm_cmpgt_pd(next, hi);
+        __m128d clamped = _mm_or_pd(_mm_and_pd(above, hi), _mm_andnot_pd(above, next));
+        clamped = _mm_or_pd(_mm_and_pd(below, lo), _mm_andnot_pd(below, clamped));
+        _mm_storeu_pd(a.out + i, clamped);
+        _mm_storeu_pd(a.vel + i, _mm_xor_pd(v, _mm_and_pd(_mm_or_pd(below, above), sign)));
+    }
+    advanceScalar(a, i, end, dt);
+}
+
+__attribute__((target("avx2"))) void advanceAvx2(const Axis &a, std::size_t begin, std::size_t end, double dt)
+{
+    const __m256d vdt = _mm256_set1_pd(dt);
+    const __m256d lo = _mm256_set1_pd(a.lo);
+    const __m256d hi = _mm256_set1_pd(a.hi);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+
+    std::size_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m256d p = _mm256_loadu_pd(a.pos + i);
+        const __m256d v = _mm256_loadu_pd(a.vel + i);
+        const __m256d next = _mm256_add_pd(p, _mm256_mul_pd(v, vdt));
+        const __m256d below = _mm256_cmp_pd(next, lo, _CMP_LT_OQ);
+        const __m256d above = _mm256_cmp_pd(next, hi, _CMP_GT_OQ);
+        const __m256d clamped = _mm256_blendv_pd(_mm256_blendv_pd(next, hi, above), lo, below);
+        _mm256_storeu_pd(a.out + i, clamped);
+        _mm256_storeu_pd(a.vel + i, _mm256_xor_pd(v, _mm256_and_pd(_mm256_or_pd(below, above), sign)));
+    }
+    advanceScalar(a, i, end, dt);
+}
+#endif
+
+Kernel kernelFor(Implementation implementation)
+{
+#if defined(ZOMBIE_HAS_SIMD)
+    __builtin_cpu_init();
+    if (implementation == Implementation::Avx2 && __builtin_cpu_supports("avx2"))
+    {
+        return &advanceAvx2;
+    }
+    if (implementation == Implementation::Sse2 && __builtin_cpu_supports("sse2"))
+    {
+        return &advanceSse2;
+    }
+#endif
+    return implementation == Implementation::Scalar ? &advanceScalar : nullptr;
+}
+
+struct Selected
+{
+    Kernel kernel;
+    const char *name;
+};
+
+Selected select()
+{
+    if (const Kernel kernel = kernelFor(Implementation::Avx2))
+    {
+        return {kernel, "avx2"};
+    }
+    if (const Kernel kernel = kernelFor(Implementation::Sse2))
+    {
+        return {kernel, "sse2"};
+    }
+    return {&advanceScalar, "scalar"};
+}
+
+const Selected &selected()
+{
+    static const Selected s = select();
+    return s;
+}
+}
+
+void advance(const Axis &axis, std::size_t count, double dt)
+{
+    selected().kernel(axis, 0, count, dt);
+}
+
+const char *implementationName()
+{
+    return selected().name;
+}
+
+bool isSupported(Implementation implementation)
+{
+    return kernelFor(implementation) != nullptr;
+}
+
+bool advanceWith(Implementation implementation, const Axis &axis, std::size_t count, double dt)
+{
+    const Kernel kernel = kernelFor(implementation);
+    if (kernel == nullptr)
+    {
+        return false;
+    }
+    kernel(axis, 0, count, dt);
+    return true;
+}
+}
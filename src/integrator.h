@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+// Пакетный интегратор: p' = p + v * dt, при выходе за [lo, hi] координата прижимается к границе,
+// а проекция скорости меняет знак. Реализация выбирается один раз по возможностям процессора
+// (AVX2, SSE2 или скалярная), результат побитово совпадает во всех вариантах, включая NaN, ±0.0 и ±inf.
+// Исключение — NaN и в позиции, и в v * dt: какой из двух NaN вернёт сложение, IEEE 754 не задаёт,
+// а компилятор вправе переставить слагаемые, поэтому совпадает только то, что результат — NaN.
+namespace integrator
+{
+struct Axis
+{
+    const double *pos;
+    double *vel;
+    double *out;
+    double lo;
+    double hi;
+};
+
+enum class Implementation
+{
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+void advance(const Axis &axis, std::size_t count, double dt);
+
+const char *implementationName();
+
+// Конкретный вариант в обход выбора по процессору, чтобы сравнивать варианты между собой.
+// Scalar поддерживается всегда; advanceWith неподдерживаемого варианта ничего не делает и возвращает false.
+bool isSupported(Implementation implementation);
+bool advanceWith(Implementation implementation, const Axis &axis, std::size_t count, double dt);
+}
@@ -1,7 +1,20 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include <QFileDialog>
+#include <QSignalBlocker>
+
 #include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+
+namespace
+{
+constexpr int kFrameIntervalMs = 16;
+// С этого числа точек облако одного типа агентов рисуется растровым путём.
+constexpr int kRasterScatterPoints = 5000;
+}
 
 MainWindow::MainWindow()
     : ui(std::make_unique<Ui::MainWindow>())
@@ -9,22 +22,50 @@ MainWindow::MainWindow()
     setupUi();
     setupPlots();
 
-    connect(&m_timer, &QTimer::timeout, this, &MainWindow::onTick);
-    connect(&m_world, &World::populationChanged, this, &MainWindow::onPopulationChanged);
+    m_worker = new SimulationWorker;
+    m_worker->moveToThread(&m_simThread);
+    connect(&m_simThread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &SimulationWorker::metricsBatch, this, &MainWindow::onMetricsBatch);
+    connect(m_worker, &SimulationWorker::rateChanged, this, &MainWindow::onRateChanged);
+    connect(m_worker, &SimulationWorker::recordingChanged, this, &MainWindow::onRecordingChanged);
+    m_simThread.start();
+
+    connect(&m_frameTimer, &QTimer::timeout, this, &MainWindow::onFrame);
+    m_frameTimer.start(kFrameIntervalMs);
 
     resetWorldFromInputs();
 }
 
-MainWindow::~MainWindow() = default;
+MainWindow::~MainWindow()
+{
+    m_frameTimer.stop();
+    m_simThread.quit();
+    m_simThread.wait();
+
+    if (m_ensembleThread != nullptr)
+    {
+        m_ensembleThread->wait();
+    }
+}
 
 void MainWindow::setupUi()
 {
     ui->setupUi(this);
 
     connect(ui->initButton, &QPushButton::clicked, this, &MainWindow::onInit);
+    connect(ui->ensembleButton, &QPushButton::clicked, this, &MainWindow::onEnsemble);
     connect(ui->startButton, &QPushButton::clicked, this, &MainWindow::onStart);
     connect(ui->pauseButton, &QPushButton::clicked, this, &MainWindow::onPause);
     connect(ui->stopButton, &QPushButton::clicked, this, &MainWindow::onStop);
+    connect(ui->recordButton, &QPushButton::toggled, this, &MainWindow::onRecordToggled);
+    connect(ui->replayButton, &QPushButton::clicked, this, &MainWindow::onReplayOpen);
+    connect(ui->replaySlider, &QSlider::valueChanged, this, &MainWindow::onReplayFrame);
+    connect(ui->stepsPerTickSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int steps) {
+        QMetaObject::invokeMethod(m_worker, [worker = m_worker, steps] { worker->setStepsPerTick(steps); });
+    });
+    connect(ui->densityThresholdSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int agents) {
+        QMetaObject::invokeMethod(m_worker, [worker = m_worker, agents] { worker->setDensityThreshold(agents); });
+    });
 }
 
 void MainWindow::setupPlots()
@@ -41,9 +82,16 @@ void MainWindow::setupPlots()
     zombiesGraph->setScatterStyle(
         QCPScatterStyle(QCPScatterStyle::ssCircle, QPen(zombieColor), QBrush(zombieColor), 9.0));
 
+    auto *density = ui->worldPlot->addDensityMap();
+    density->setChannelCount(2);
+    density->setChannelColor(0, Qt::blue);
+    density->setChannelColor(1, zombieColor);
+    density->setVisible(false);
+
     ui->worldPlot->xAxis->setLabel(QString());
     ui->worldPlot->yAxis->setLabel(QString());
     ui->worldPlot->setBackground(Qt::white);
+    ui->worldPlot->setRasterScatterThreshold(kRasterScatterPoints);
 
     ui->historyPlot->clearGraphs();
     auto *humanLine = ui->historyPlot->addGraph();
@@ -54,107 +102,324 @@ void MainWindow::setupPlots()
     zombieLine->setPen(QPen(QColor(0, 90, 0), 2.0));
     zombieLine->setLineStyle(QCPGraph::lsLine);
 
+    auto *infectedLine = ui->historyPlot->addGraph();
+    infectedLine->setPen(QPen(QColor(200, 120, 0), 1.5));
+    infectedLine->setLineStyle(QCPGraph::lsLine);
+
+    // Полосы ансамбля: нижний квантиль, верхний квантиль с заливкой до нижнего, среднее.
+    const QColor bandColors[] = {QColor(0, 0, 255), QColor(0, 90, 0)};
+    for (const QColor &color : bandColors)
+    {
+        auto *low = ui->historyPlot->addGraph();
+        low->setPen(Qt::NoPen);
+        low->setLineStyle(QCPGraph::lsLine);
+
+        auto *high = ui->historyPlot->addGraph();
+        high->setPen(Qt::NoPen);
+        high->setLineStyle(QCPGraph::lsLine);
+        QColor fill = color;
+        fill.setAlpha(40);
+        high->setBrush(fill);
+        high->setChannelFillGraph(low);
+
+        auto *mean = ui->historyPlot->addGraph();
+        mean->setPen(QPen(color, 1.0, Qt::DashLine));
+        mean->setLineStyle(QCPGraph::lsLine);
+    }
+
     ui->historyPlot->xAxis->setLabel(QString());
     ui->historyPlot->yAxis->setLabel(QStringLiteral("N"));
 }
 
+SimulationParams MainWindow::paramsFromInputs() const
+{
+    SimulationParams params;
+    params.humans = ui->humansSpin->value();
+    params.zombies = ui->zombiesSpin->value();
+    params.dt = ui->dtSpin->value();
+    params.biteRadius = ui->biteRadiusSpin->value();
+    params.incubation = ui->incubationSpin->value();
+    params.perception = ui->perceptionSpin->value();
+    params.pursuit =
+        ui->pursuitCombo->currentIndex() == 1 ? World::PursuitMode::FlowField : World::PursuitMode::Nearest;
+    params.threads = ui->threadsSpin->value();
+    params.stepsPerTick = ui->stepsPerTickSpin->value();
+    params.densityThreshold = ui->densityThresholdSpin->value();
+    params.seed = m_seed;
+    return params;
+}
+
 void MainWindow::resetWorldFromInputs()
 {
-    m_timer.stop();
-    m_timeHistory.clear();
-    m_humanHistory.clear();
-    m_zombieHistory.clear();
+    m_history.clear();
+
+    std::random_device rd;
+    m_seed = (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
 
-    m_world.setDefaultBiteRadius(ui->biteRadiusSpin->value());
-    m_world.reset(ui->humansSpin->value(), ui->zombiesSpin->value());
+    const SimulationParams params = paramsFromInputs();
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker, params] { worker->reset(params); });
 
-    refreshWorldPlot();
     refreshHistoryPlot();
 }
 
 void MainWindow::onInit()
 {
+    leaveReplay();
     resetWorldFromInputs();
 }
 
 void MainWindow::onStart()
 {
-    if (!m_timer.isActive())
-    {
-        m_world.setDefaultBiteRadius(ui->biteRadiusSpin->value());
-        m_timer.start(60);
-    }
+    leaveReplay();
+    const SimulationParams params = paramsFromInputs();
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker, params] { worker->start(params); });
 }
 
 void MainWindow::onPause()
 {
-    m_timer.stop();
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker] { worker->pause(); });
 }
 
 void MainWindow::onStop()
 {
-    m_timer.stop();
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker] { worker->pause(); });
     refreshHistoryPlot();
 }
 
-void MainWindow::onTick()
+void MainWindow::onFrame()
+{
+    if (m_replay)
+    {
+        return;
+    }
+    TripleBuffer<WorldSnapshot> &snapshots = m_worker->snapshots();
+    if (snapshots.update())
+    {
+        refreshWorldPlot(snapshots.readBuffer());
+    }
+}
+
+void MainWindow::onRecordToggled(bool checked)
 {
-    m_world.step(ui->dtSpin->value());
-    refreshWorldPlot();
+    if (!checked)
+    {
+        QMetaObject::invokeMethod(m_worker, [worker = m_worker] { worker->stopRecording(); });
+        return;
+    }
+
+    const QString path = QFileDialog::getSaveFileName(this, QStringLiteral("Запись траектории"), QString(),
+                                                      QStringLiteral("Траектории (*.ztrj)"));
+    if (path.isEmpty())
+    {
+        const QSignalBlocker blocker(ui->recordButton);
+        ui->recordButton->setChecked(false);
+        return;
+    }
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker, path] { worker->startRecording(path); });
 }
 
-void MainWindow::onPopulationChanged(int humans, int zombies, double time)
+void MainWindow::onRecordingChanged(bool recording, const QString &error)
 {
-    appendHistory(humans, zombies, time);
-    updateStatusLabel(humans, zombies, time);
-    refreshHistoryPlot();
+    const QSignalBlocker blocker(ui->recordButton);
+    ui->recordButton->setChecked(recording);
+    if (!error.isEmpty())
+    {
+        ui->statusLabel->setText(QStringLiteral("ошибка записи траектории: %1").arg(error));
+    }
+}
+
+void MainWindow::onReplayOpen()
+{
+    const QString path = QFileDialog::getOpenFileName(this, QStringLiteral("Открыть запись"), QString(),
+                                                      QStringLiteral("Траектории (*.ztrj)"));
+    if (path.isEmpty())
+    {
+        return;
+    }
+
+    auto reader = std::make_unique<TrajectoryReader>();
+    if (!reader->open(path))
+    {
+        ui->statusLabel->setText(QStringLiteral("запись не прочитана: %1").arg(reader->errorString()));
+        return;
+    }
+
+    onPause();
+    m_replay = std::move(reader);
+    const QSignalBlocker blocker(ui->replaySlider);
+    ui->replaySlider->setRange(0, m_replay->frameCount() - 1);
+    ui->replaySlider->setValue(0);
+    ui->replaySlider->setEnabled(true);
+    onReplayFrame(0);
+}
+
+void MainWindow::onReplayFrame(int frame)
+{
+    if (!m_replay || !m_replay->seek(frame))
+    {
+        return;
+    }
+
+    m_replaySnapshot.time = m_replay->time();
+    m_replaySnapshot.bounds = m_replay->bounds();
+    m_replaySnapshot.density = false;
+    m_replay->positions(ObjType::Human, m_replaySnapshot.humanX, m_replaySnapshot.humanY);
+    m_replay->positions(ObjType::Zombie, m_replaySnapshot.zombieX, m_replaySnapshot.zombieY);
+    refreshWorldPlot(m_replaySnapshot);
+
+    ui->statusLabel->setText(QStringLiteral("запись: кадр %1/%2 | шаг %3 | t=%4 | люди=%5 | зомби=%6")
+                                 .arg(frame + 1)
+                                 .arg(m_replay->frameCount())
+                                 .arg(m_replay->frameStep(frame))
+                                 .arg(m_replay->time(), 0, 'f', 2)
+                                 .arg(static_cast<qulonglong>(m_replaySnapshot.humanX.size()))
+                                 .arg(static_cast<qulonglong>(m_replaySnapshot.zombieX.size())));
 }
 
-void MainWindow::appendHistory(int humans, int zombies, double time)
+void MainWindow::leaveReplay()
 {
-    m_timeHistory.append(time);
-    m_humanHistory.append(humans);
-    m_zombieHistory.append(zombies);
+    if (!m_replay)
+    {
+        return;
+    }
+    m_replay.reset();
+    ui->replaySlider->setEnabled(false);
 }
 
-void MainWindow::updateStatusLabel(int humans, int zombies, double time)
+void MainWindow::onEnsemble()
 {
-    ui->statusLabel->setText(
-        QStringLiteral("t=%1 | люди=%2 | зомби=%3").arg(time, 0, 'f', 2).arg(humans).arg(zombies));
+    if (m_ensembleThread != nullptr)
+    {
+        return;
+    }
+
+    EnsembleConfig cfg;
+    cfg.runs = ui->ensembleRunsSpin->value();
+    cfg.steps = ui->ensembleStepsSpin->value();
+    cfg.humans = ui->humansSpin->value();
+    cfg.zombies = ui->zombiesSpin->value();
+    cfg.dt = ui->dtSpin->value();
+    cfg.biteRadius = ui->biteRadiusSpin->value();
+    cfg.incubation = ui->incubationSpin->value();
+    cfg.perception = ui->perceptionSpin->value();
+    cfg.pursuit =
+        ui->pursuitCombo->currentIndex() == 1 ? World::PursuitMode::FlowField : World::PursuitMode::Nearest;
+    cfg.threads = ui->threadsSpin->value();
+    cfg.seed = m_seed;
+
+    auto result = std::make_shared<EnsembleResult>();
+    ui->ensembleButton->setEnabled(false);
+    ui->statusLabel->setText(QStringLiteral("ансамбль: %1 прогонов...").arg(cfg.runs));
+
+    m_ensembleThread = QThread::create([cfg, result] { *result = EnsembleRunner(cfg).run(); });
+    m_ensembleThread->setParent(this);
+    connect(m_ensembleThread, &QThread::finished, this, [this, result] {
+        m_ensembleThread->deleteLater();
+        m_ensembleThread = nullptr;
+        ui->ensembleButton->setEnabled(true);
+        showEnsemble(*result);
+    });
+    m_ensembleThread->start();
 }
 
-void MainWindow::refreshWorldPlot()
+void MainWindow::showEnsemble(const EnsembleResult &result)
 {
-    QVector<double> humanX;
-    QVector<double> humanY;
-    QVector<double> zombieX;
-    QVector<double> zombieY;
+    const EnsembleBand *bands[] = {&result.humans, &result.zombies};
+    for (int k = 0; k < 2; ++k)
+    {
+        const int base = 3 + k * 3;
+        ui->historyPlot->graph(base)->setData(result.time, bands[k]->low);
+        ui->historyPlot->graph(base + 1)->setData(result.time, bands[k]->high);
+        ui->historyPlot->graph(base + 2)->setData(result.time, bands[k]->mean);
+    }
+
+    m_ensembleLastT = result.time.isEmpty() ? 0.0 : result.time.last();
+    m_ensembleMax = 0.0;
+    for (const EnsembleBand *band : bands)
+    {
+        for (double v : band->high)
+        {
+            m_ensembleMax = std::max(m_ensembleMax, v);
+        }
+    }
+
+    ui->statusLabel->setText(QStringLiteral("ансамбль: %1 прогонов, полоса %2–%3%")
+                                 .arg(result.runs)
+                                 .arg(result.lowQuantile * 100.0)
+                                 .arg(result.highQuantile * 100.0));
+    refreshHistoryPlot();
+}
 
-    for (const auto &obj : m_world.objects())
+void MainWindow::onMetricsBatch(const QVector<World::StepMetrics> &samples)
+{
+    for (const World::StepMetrics &s : samples)
     {
-        const auto &s = obj->state();
-        if (obj->type() == ObjType::Human)
+        // Сброс мира начинает время заново: всё, что было накоплено до него, относится к прошлому прогону.
+        if (!m_history.isEmpty() && s.time <= m_history.lastTime())
         {
-            humanX.append(s.pos.x());
-            humanY.append(s.pos.y());
+            m_history.clear();
         }
-        else if (obj->type() == ObjType::Zombie)
+        m_history.append(s);
+    }
+    if (!samples.isEmpty())
+    {
+        m_lastSample = samples.last();
+        updateStatusLabel();
+    }
+    refreshHistoryPlot();
+}
+
+void MainWindow::onRateChanged(double stepsPerSecond, double agentStepsPerSecond)
+{
+    m_stepsPerSecond = stepsPerSecond;
+    m_agentStepsPerSecond = agentStepsPerSecond;
+    updateStatusLabel();
+}
+
+void MainWindow::updateStatusLabel()
+{
+    QString text = QStringLiteral("t=%1 | люди=%2 (заражены %3) | зомби=%4 | укусы=%5 | |v|=%6 | "
+                                  "до цели=%7")
+                       .arg(m_lastSample.time, 0, 'f', 2)
+                       .arg(m_lastSample.humans)
+                       .arg(m_lastSample.infected)
+                       .arg(m_lastSample.zombies)
+                       .arg(m_lastSample.bites)
+                       .arg(m_lastSample.meanSpeed, 0, 'f', 1)
+                       .arg(m_lastSample.meanTargetDistance, 0, 'f', 1);
+    if (m_stepsPerSecond > 0.0)
+    {
+        text += QStringLiteral(" | %1 шаг/с | %2 агенто-шаг/с")
+                    .arg(m_stepsPerSecond, 0, 'f', 0)
+                    .arg(m_agentStepsPerSecond, 0, 'g', 3);
+    }
+    ui->statusLabel->setText(text);
+}
+
+void MainWindow::refreshWorldPlot(const WorldSnapshot &snapshot)
+{
+    if (auto *map = ui->worldPlot->densityMap(0))
+    {
+        map->setVisible(snapshot.density);
+        if (snapshot.density)
         {
-            zombieX.append(s.pos.x());
-            zombieY.append(s.pos.y());
+            map->setRange(snapshot.bounds);
+            map->setSize(snapshot.densityColumns, snapshot.densityRows);
+            map->setChannelData(0, snapshot.humanDensity.data(), static_cast<int>(snapshot.humanDensity.size()));
+            map->setChannelData(1, snapshot.zombieDensity.data(), static_cast<int>(snapshot.zombieDensity.size()));
         }
     }
 
     if (auto *g = ui->worldPlot->graph(0))
     {
-        g->setData(humanX, humanY);
+        g->setData(snapshot.humanX.data(), snapshot.humanY.data(), static_cast<int>(snapshot.humanX.size()));
     }
     if (auto *g = ui->worldPlot->graph(1))
     {
-        g->setData(zombieX, zombieY);
+        g->setData(snapshot.zombieX.data(), snapshot.zombieY.data(), static_cast<int>(snapshot.zombieX.size()));
     }
 
-    const QRectF b = m_world.bounds();
+    const QRectF b = snapshot.bounds;
     ui->worldPlot->xAxis->setRange(b.left(), b.right());
     ui->worldPlot->yAxis->setRange(b.top(), b.bottom());
     ui->worldPlot->replot();
@@ -162,27 +427,25 @@ void MainWindow::refreshWorldPlot()
 
 void MainWindow::refreshHistoryPlot()
 {
-    if (auto *g = ui->historyPlot->graph(0))
-    {
-        g->setData(m_timeHistory, m_humanHistory);
-    }
-    if (auto *g = ui->historyPlot->graph(1))
-    {
-        g->setData(m_timeHistory, m_zombieHistory);
-    }
+    const double lastT = std::max({1.0, m_history.lastTime(), m_ensembleLastT});
+    const double maxPop = std::max({1.0, m_ensembleMax, m_history.max(MetricsStore::Humans),
+                                    m_history.max(MetricsStore::Zombies)});
 
-    const double lastT = m_timeHistory.isEmpty() ? 1.0 : m_timeHistory.last();
-    int maxPop = 1;
-    for (int v : m_humanHistory)
-    {
-        maxPop = std::max(maxPop, v);
-    }
-    for (int v : m_zombieHistory)
+    // Сводки хранилища отдают не больше ~2 точек на пиксель, сколько бы шагов ни накопилось.
+    const int budget = 2 * std::max(ui->historyPlot->width(), 1);
+    const MetricsStore::Column columns[] = {MetricsStore::Humans, MetricsStore::Zombies, MetricsStore::Infected};
+    for (int k = 0; k < 3; ++k)
     {
-        maxPop = std::max(maxPop, v);
+        if (auto *g = ui->historyPlot->graph(k))
+        {
+            QVector<double> times;
+            QVector<double> values;
+            m_history.query(columns[k], 0.0, lastT, budget, times, values);
+            g->setData(times, values);
+        }
     }
 
-    ui->historyPlot->xAxis->setRange(0.0, std::max(1.0, lastT));
-    ui->historyPlot->yAxis->setRange(0.0, static_cast<double>(maxPop) * 1.1 + 1e-3);
+    ui->historyPlot->xAxis->setRange(0.0, lastT);
+    ui->historyPlot->yAxis->setRange(0.0, std::ceil(maxPop) * 1.1 + 1e-3);
     ui->historyPlot->replot();
 }
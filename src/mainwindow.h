@@ -1,11 +1,16 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QThread>
 #include <QTimer>
 #include <QVector>
+#include <cstdint>
 #include <memory>
 
-#include "world.h"
+#include "ensemble.h"
+#include "metricsstore.h"
+#include "simulationworker.h"
+#include "trajectory.h"
 
 namespace Ui
 {
@@ -24,24 +29,44 @@ private slots:
     void onStart();
     void onPause();
     void onStop();
-    void onTick();
-    void onPopulationChanged(int humans, int zombies, double time);
+    void onFrame();
+    void onEnsemble();
+    void onMetricsBatch(const QVector<World::StepMetrics> &samples);
+    void onRateChanged(double stepsPerSecond, double agentStepsPerSecond);
+    void onRecordToggled(bool checked);
+    void onRecordingChanged(bool recording, const QString &error);
+    void onReplayOpen();
+    void onReplayFrame(int frame);
 
 private:
     void setupUi();
     void setupPlots();
     void resetWorldFromInputs();
-    void refreshWorldPlot();
+    SimulationParams paramsFromInputs() const;
+    void refreshWorldPlot(const WorldSnapshot &snapshot);
     void refreshHistoryPlot();
-    void appendHistory(int humans, int zombies, double time);
-    void updateStatusLabel(int humans, int zombies, double time);
+    void leaveReplay();
+    void showEnsemble(const EnsembleResult &result);
+    void updateStatusLabel();
 
     std::unique_ptr<Ui::MainWindow> ui;
 
-    QTimer m_timer;
-    World m_world;
+    // Мир живёт в m_simThread; окно только читает снимки с частотой кадров и получает пачки численности.
+    QThread m_simThread;
+    SimulationWorker *m_worker{nullptr};
+    QTimer m_frameTimer;
+    std::uint64_t m_seed{0};
+    World::StepMetrics m_lastSample;
+    double m_stepsPerSecond{0.0};
+    double m_agentStepsPerSecond{0.0};
 
-    QVector<double> m_timeHistory;
-    QVector<double> m_humanHistory;
-    QVector<double> m_zombieHistory;
+    MetricsStore m_history;
+
+    // Режим просмотра записи: живой мир на паузе, кадры берутся из файла ползунком.
+    std::unique_ptr<TrajectoryReader> m_replay;
+    WorldSnapshot m_replaySnapshot;
+
+    QThread *m_ensembleThread{nullptr};
+    double m_ensembleLastT{0.0};
+    double m_ensembleMax{0.0};
 };
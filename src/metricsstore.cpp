@@ -0,0 +1,210 @@
+#include "metricsstore.h"
+
+#include <algorithm>
+
+void MetricsStore::clear()
+{
+    m_chunks.clear();
+    m_size = 0;
+    m_min.fill(0.0);
+    m_max.fill(0.0);
+    for (auto &level : m_levels)
+    {
+        for (std::deque<Summary> &column : level)
+        {
+            column.clear();
+        }
+    }
+}
+
+void MetricsStore::append(const World::StepMetrics &metrics)
+{
+    const std::array<double, ColumnCount> row = {static_cast<double>(metrics.humans),
+                                                 static_cast<double>(metrics.zombies),
+                                                 static_cast<double>(metrics.infected),
+                                                 static_cast<double>(metrics.bites), metrics.meanSpeed,
+                                                 metrics.meanTargetDistance};
+
+    const std::size_t index = m_size;
+    if ((index & (kChunkSize - 1)) == 0)
+    {
+        m_chunks.push_back(std::make_unique<Chunk>());
+    }
+    Chunk &chunk = *m_chunks.back();
+    const std::size_t slot = index & (kChunkSize - 1);
+    chunk.time[slot] = metrics.time;
+
+    for (int c = 0; c < ColumnCount; ++c)
+    {
+        const double v = row[static_cast<std::size_t>(c)];
+        chunk.values[static_cast<std::size_t>(c)][slot] = v;
+
+        m_min[static_cast<std::size_t>(c)] = index == 0 ? v : std::min(m_min[static_cast<std::size_t>(c)], v);
+        m_max[static_cast<std::size_t>(c)] = index == 0 ? v : std::max(m_max[static_cast<std::size_t>(c)], v);
+
+        for (int l = 0; l < kLevelCount; ++l)
+        {
+            std::deque<Summary> &level = m_levels[static_cast<std::size_t>(l)][static_cast<std::size_t>(c)];
+            const std::size_t group = index >> ((l + 1) * kLevelShift);
+            if (group == level.size())
+            {
+                level.push_back({v, metrics.time, v, metrics.time});
+                continue;
+            }
+            Summary &s = level.back();
+            if (v < s.minValue)
+            {
+                s.minValue = v;
+                s.minTime = metrics.time;
+            }
+            if (v > s.maxValue)
+            {
+                s.maxValue = v;
+                s.maxTime = metrics.time;
+            }
+        }
+    }
+    ++m_size;
+}
+
+std::size_t MetricsStore::size() const
+{
+    return m_size;
+}
+
+bool MetricsStore::isEmpty() const
+{
+    return m_size == 0;
+}
+
+double MetricsStore::time(std::size_t row) const
+{
+    return m_chunks[row >> kChunkShift]->time[row & (kChunkSize - 1)];
+}
+
+double MetricsStore::value(Column column, std::size_t row) const
+{
+    return m_chunks[row >> kChunkShift]->values[static_cast<std::size_t>(column)][row & (kChunkSize - 1)];
+}
+
+double MetricsStore::lastTime() const
+{
+    return m_size == 0 ? 0.0 : time(m_size - 1);
+}
+
+double MetricsStore::min(Column column) const
+{
+    return m_min[static_cast<std::size_t>(column)];
+}
+
+double MetricsStore::max(Column column) const
+{
+    return m_max[static_cast<std::size_t>(column)];
+}
+
+std::size_t MetricsStore::lowerBound(double t) const
+{
+    std::size_t lo = 0;
+    std::size_t hi = m_size;
+    while (lo < hi)
+    {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        if (time(mid) < t)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+std::size_t MetricsStore::upperBound(double t) const
+{
+    std::size_t lo = 0;
+    std::size_t hi = m_size;
+    while (lo < hi)
+    {
+        const std::size_t mid = lo + (hi - lo) / 2;
+        if (time(mid) <= t)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void MetricsStore::query(Column column, double t0, double t1, int maxPoints, QVector<double> &times,
+                         QVector<double> &values) const
+{
+    times.clear();
+    values.clear();
+    if (m_size == 0 || t1 < t0)
+    {
+        return;
+    }
+
+    // Плюс строка с каждой стороны, чтобы линия доходила до краёв диапазона.
+    const std::size_t lower = lowerBound(t0);
+    const std::size_t first = lower > 0 ? lower - 1 : 0;
+    const std::size_t last = std::min(upperBound(t1) + 1, m_size);
+    if (first >= last)
+    {
+        return;
+    }
+    const std::size_t rows = last - first;
+    const auto budget = static_cast<std::size_t>(std::max(maxPoints, 2));
+
+    if (rows <= budget)
+    {
+        times.reserve(static_cast<int>(rows));
+        values.reserve(static_cast<int>(rows));
+        for (std::size_t r = first; r < last; ++r)
+        {
+            times.append(time(r));
+            values.append(value(column, r));
+        }
+        return;
+    }
+
+    // Каждая группа даёт две точки (минимум и максимум).
+    int level = 0;
+    while (level + 1 < kLevelCount && 2 * (rows >> ((level + 1) * kLevelShift)) > budget)
+    {
+        ++level;
+    }
+    const int shift = (level + 1) * kLevelShift;
+    const std::deque<Summary> &groups = m_levels[static_cast<std::size_t>(level)][static_cast<std::size_t>(column)];
+    const std::size_t g0 = first >> shift;
+    const std::size_t g1 = (last - 1) >> shift;
+
+    times.reserve(static_cast<int>(2 * (g1 - g0 + 1)));
+    values.reserve(static_cast<int>(2 * (g1 - g0 + 1)));
+    for (std::size_t g = g0; g <= g1; ++g)
+    {
+        const Summary &s = groups[g];
+        if (s.minTime <= s.maxTime)
+        {
+            times.append(s.minTime);
+            values.append(s.minValue);
+            if (s.maxTime != s.minTime)
+            {
+                times.append(s.maxTime);
+                values.append(s.maxValue);
+            }
+        }
+        else
+        {
+            times.append(s.maxTime);
+            values.append(s.maxValue);
+            times.append(s.minTime);
+            values.append(s.minValue);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QVector>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "world.h"
+
+// Столбцовое хранилище сводок шагов. Строки лежат кусками фиксированного размера, поэтому добавление —
+// O(1) без переноса накопленного. Для каждого столбца поддерживаются общий минимум/максимум и уровни
+// сводки (минимум и максимум по группам из 16, 256, ... строк), так что выборка для графика стоит
+// O(видимых точек) независимо от длины прогона.
+class MetricsStore
+{
+public:
+    enum Column
+    {
+        Humans,
+        Zombies,
+        Infected,
+        Bites,
+        MeanSpeed,
+        MeanTargetDistance,
+        ColumnCount
+    };
+
+    void clear();
+    void append(const World::StepMetrics &metrics);
+
+    std::size_t size() const;
+    bool isEmpty() const;
+    double time(std::size_t row) const;
+    double value(Column column, std::size_t row) const;
+    double lastTime() const;
+
+    double min(Column column) const;
+    double max(Column column) const;
+
+    // Точки столбца на [t0, t1]: сырые строки, если их не больше maxPoints, иначе минимумы и
+    // максимумы групп самого мелкого уровня, укладывающегося в бюджет, в порядке времени.
+    void query(Column column, double t0, double t1, int maxPoints, QVector<double> &times,
+               QVector<double> &values) const;
+
+private:
+    static constexpr std::size_t kChunkShift = 12;
+    static constexpr std::size_t kChunkSize = std::size_t{1} << kChunkShift;
+    static constexpr int kLevelShift = 4;
+    static constexpr int kLevelCount = 5;
+
+    struct Chunk
+    {
+        std::array<double, kChunkSize> time;
+        std::array<std::array<double, kChunkSize>, ColumnCount> values;
+    };
+
+    struct Summary
+    {
+        double minValue;
+        double minTime;
+        double maxValue;
+        double maxTime;
+    };
+
+    std::size_t lowerBound(double t) const;
+    std::size_t upperBound(double t) const;
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    std::size_t m_size{0};
+    std::array<double, ColumnCount> m_min{};
+    std::array<double, ColumnCount> m_max{};
+    // m_levels[l][c][k] — сводка столбца c по строкам [k << s, (k + 1) << s), s = (l + 1) * kLevelShift.
+    std::array<std::array<std::deque<Summary>, ColumnCount>, kLevelCount> m_levels;
+};
@@ -0,0 +1,142 @@
+#include "mortonorder.h"
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr int kRadixBits = 8;
+constexpr std::size_t kBuckets = std::size_t{1} << kRadixBits;
+// Ниже этого размера блоки не окупают раздачу задач.
+constexpr std::size_t kMinBlock = 16384;
+constexpr std::size_t kMaxBlocks = 64;
+
+// Раздвигает 16 бит через один: abcd -> 0a0b0c0d.
+std::uint32_t spreadBits(std::uint32_t v)
+{
+    v &= 0xFFFFu;
+    v = (v | (v << 8)) & 0x00FF00FFu;
+    v = (v | (v << 4)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    v = (v | (v << 1)) & 0x55555555u;
+    return v;
+}
+
+// Прижимается ещё в double: std::clamp пропускает NaN, а его приведение к целому — неопределённое
+// поведение. NaN уходит в ноль.
+std::uint32_t quantize(double v, double origin, double scale)
+{
+    const double q = (v - origin) * scale;
+    if (!(q > 0.0))
+    {
+        return 0;
+    }
+    return q >= 65535.0 ? 65535u : static_cast<std::uint32_t>(q);
+}
+}
+
+std::uint32_t MortonOrder::key(double x, double y, const QRectF &bounds)
+{
+    const double sx = 65535.0 / std::max(bounds.width(), 1e-9);
+    const double sy = 65535.0 / std::max(bounds.height(), 1e-9);
+    return spreadBits(quantize(x, bounds.left(), sx)) | (spreadBits(quantize(y, bounds.top(), sy)) << 1);
+}
+
+void MortonOrder::sort(const double *xs, const double *ys, std::size_t begin, std::size_t end, const QRectF &bounds,
+                       int bitsPerAxis, ThreadPool *pool, std::vector<std::uint32_t> &order)
+{
+    bitsPerAxis = std::clamp(bitsPerAxis, 1, 16);
+    const int drop = 2 * (16 - bitsPerAxis);
+    const int passes = (2 * bitsPerAxis + kRadixBits - 1) / kRadixBits;
+
+    const std::size_t n = end > begin ? end - begin : 0;
+    order.resize(n);
+    m_keys.resize(n);
+    m_keysTmp.resize(n);
+    m_orderTmp.resize(n);
+    if (n == 0)
+    {
+        return;
+    }
+
+    const std::size_t blocks = pool ? std::clamp<std::size_t>(n / kMinBlock, 1, kMaxBlocks) : 1;
+    const std::size_t blockSize = (n + blocks - 1) / blocks;
+    m_counts.assign(blocks * kBuckets, 0);
+
+    const auto run = [pool, blocks](const ThreadPool::TaskFn &fn) {
+        if (pool && blocks > 1)
+        {
+            pool->runTasks(blocks, fn);
+        }
+        else
+        {
+            for (std::size_t b = 0; b < blocks; ++b)
+            {
+                fn(b, 0);
+            }
+        }
+    };
+
+    run([&](std::size_t b, int) {
+        const std::size_t lo = b * blockSize;
+        const std::size_t hi = std::min(n, lo + blockSize);
+        for (std::size_t i = lo; i < hi; ++i)
+        {
+            m_keys[i] = key(xs[begin + i], ys[begin + i], bounds) >> drop;
+            order[i] = static_cast<std::uint32_t>(i);
+        }
+    });
+
+    std::uint32_t *keys = m_keys.data();
+    std::uint32_t *keysOut = m_keysTmp.data();
+    std::uint32_t *rows = order.data();
+    std::uint32_t *rowsOut = m_orderTmp.data();
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        const int shift = pass * kRadixBits;
+
+        run([&](std::size_t b, int) {
+            std::uint32_t *counts = m_counts.data() + b * kBuckets;
+            std::fill(counts, counts + kBuckets, 0u);
+            const std::size_t hi = std::min(n, (b + 1) * blockSize);
+            for (std::size_t i = b * blockSize; i < hi; ++i)
+            {
+                ++counts[(keys[i] >> shift) & (kBuckets - 1)];
+            }
+        });
+
+        // Смещения: по корзинам, внутри корзины — по блокам, чтобы раскладка осталась устойчивой.
+        std::uint32_t offset = 0;
+        for (std::size_t bucket = 0; bucket < kBuckets; ++bucket)
+        {
+            for (std::size_t b = 0; b < blocks; ++b)
+            {
+                std::uint32_t &c = m_counts[b * kBuckets + bucket];
+                const std::uint32_t count = c;
+                c = offset;
+                offset += count;
+            }
+        }
+
+        run([&](std::size_t b, int) {
+            std::uint32_t *cursor = m_counts.data() + b * kBuckets;
+            const std::size_t hi = std::min(n, (b + 1) * blockSize);
+            for (std::size_t i = b * blockSize; i < hi; ++i)
+            {
+                const std::uint32_t slot = cursor[(keys[i] >> shift) & (kBuckets - 1)]++;
+                keysOut[slot] = keys[i];
+                rowsOut[slot] = rows[i];
+            }
+        });
+
+        std::swap(keys, keysOut);
+        std::swap(rows, rowsOut);
+    }
+
+    // После нечётного числа проходов результат лежит в рабочем буфере.
+    if (rows != order.data())
+    {
+        std::copy(rows, rows + n, order.data());
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QRectF>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Порядок строк по кривой Мортона (Z-order) над прямоугольником мира: координаты квантуются в 16 бит
+// по оси, биты чередуются в 32-битный ключ, ключи сортируются поразрядно (LSD, проходы по 8 бит).
+// Разрешение задаётся числом старших бит на ось: агенты в одной ячейке кривой сохраняют прежний
+// порядок, и сортировка стоит столько проходов, сколько байт занимает укороченный ключ.
+// С пулом массив делится на фиксированное число блоков: гистограммы и раскладка блоков идут
+// параллельно, смещения считаются последовательно, поэтому результат не зависит от числа потоков.
+// Сортировка устойчивая: строки с одинаковым ключом сохраняют прежний относительный порядок.
+class MortonOrder
+{
+public:
+    static std::uint32_t key(double x, double y, const QRectF &bounds);
+
+    // order получает исходные номера строк [begin, end) в порядке кривой, смещённые на begin.
+    void sort(const double *xs, const double *ys, std::size_t begin, std::size_t end, const QRectF &bounds,
+              int bitsPerAxis, ThreadPool *pool, std::vector<std::uint32_t> &order);
+
+private:
+    std::vector<std::uint32_t> m_keys;
+    std::vector<std::uint32_t> m_keysTmp;
+    std::vector<std::uint32_t> m_orderTmp;
+    std::vector<std::uint32_t> m_counts;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "spatialgrid.h"
+#include "worldobject.h"
+
+// Ответ пакетного запроса соседей мира: для каждой точки запроса — непрерывный кусок слотов агентов
+// по возрастанию. Владеет вызывающий; повторные пакеты переиспользуют ёмкость и не выделяют память.
+// Действителен до следующего шага мира, как и AgentRef.
+class NeighborBatch
+{
+public:
+    std::size_t size() const { return m_first.size(); }
+    std::size_t count(std::size_t query) const { return m_count[query]; }
+    const AgentIndex *begin(std::size_t query) const { return m_indices.data() + m_first[query]; }
+    const AgentIndex *end(std::size_t query) const { return begin(query) + m_count[query]; }
+    // Все найденные слоты подряд, куски запросов — в порядке обхода, а не в порядке запросов.
+    const std::vector<AgentIndex> &indices() const { return m_indices; }
+
+private:
+    friend class World;
+
+    void reset(std::size_t queries)
+    {
+        m_first.assign(queries, 0);
+        m_count.assign(queries, 0);
+        m_indices.clear();
+    }
+
+    std::vector<std::uint32_t> m_first;
+    std::vector<std::uint32_t> m_count;
+    std::vector<AgentIndex> m_indices;
+    SpatialGrid::BatchScratch m_scratch;
+};
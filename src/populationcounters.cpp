@@ -0,0 +1,83 @@
+#include "populationcounters.h"
+
+namespace
+{
+std::size_t idx(ObjType type)
+{
+    return static_cast<std::size_t>(type);
+}
+
+std::size_t idx(ObjStatus status)
+{
+    return static_cast<std::size_t>(status);
+}
+}
+
+void PopulationCounters::clear()
+{
+    for (auto &row : m_counts)
+    {
+        row.fill(0);
+    }
+}
+
+void PopulationCounters::add(ObjType type, ObjStatus status, int count)
+{
+    m_counts[idx(type)][idx(status)] += count;
+}
+
+void PopulationCounters::move(ObjType fromType, ObjStatus fromStatus, ObjType toType, ObjStatus toStatus)
+{
+    --m_counts[idx(fromType)][idx(fromStatus)];
+    ++m_counts[idx(toType)][idx(toStatus)];
+}
+
+PopulationCounters &PopulationCounters::operator+=(const PopulationCounters &other)
+{
+    for (std::size_t t = 0; t < kObjTypeCount; ++t)
+    {
+        for (std::size_t s = 0; s < kObjStatusCount; ++s)
+        {
+            m_counts[t][s] += other.m_counts[t][s];
+        }
+    }
+    return *this;
+}
+
+int PopulationCounters::count(ObjType type, ObjStatus status) const
+{
+    return m_counts[idx(type)][idx(status)];
+}
+
+int PopulationCounters::count(ObjType type) const
+{
+    int sum = 0;
+    for (int c : m_counts[idx(type)])
+    {
+        sum += c;
+    }
+    return sum;
+}
+
+int PopulationCounters::count(ObjStatus status) const
+{
+    int sum = 0;
+    for (const auto &row : m_counts)
+    {
+        sum += row[idx(status)];
+    }
+    return sum;
+}
+
+int PopulationCounters::total() const
+{
+    int sum = 0;
+    for (const auto &row : m_counts)
+    {
+        for (int c : row)
+        {
+            sum += c;
+        }
+    }
+    return sum;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <array>
+
+#include "worldobject.h"
+
+// Счётчики агентов в разрезе тип × статус. Обновляются в местах, где тип или статус меняется,
+// поэтому любой запрос — O(1). Значения могут быть отрицательными, если объект копит приращения
+// (например, счётчик исполнителя за один проход шага).
+class PopulationCounters
+{
+public:
+    void clear();
+
+    void add(ObjType type, ObjStatus status, int count = 1);
+    void move(ObjType fromType, ObjStatus fromStatus, ObjType toType, ObjStatus toStatus);
+    PopulationCounters &operator+=(const PopulationCounters &other);
+
+    int count(ObjType type, ObjStatus status) const;
+    int count(ObjType type) const;
+    int count(ObjStatus status) const;
+    int total() const;
+
+private:
+    std::array<std::array<int, kObjStatusCount>, kObjTypeCount> m_counts{};
+};
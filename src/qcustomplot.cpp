@@ -2,8 +2,98 @@
 
 #include <QPainter>
 #include <QtMath>
+#include <algorithm>
+#include <cmath>
 #include <limits>
 
+namespace
+{
+// Наложение premultiplied ARGB «поверх»: d = s + d * (255 - a(s)) / 255 сразу по двум каналам.
+inline QRgb blendOver(QRgb src, QRgb dst)
+{
+    const quint32 inv = 255 - qAlpha(src);
+    quint32 rb = (dst & 0x00ff00ff) * inv;
+    rb = ((rb + ((rb >> 8) & 0x00ff00ff) + 0x00800080) >> 8) & 0x00ff00ff;
+    quint32 ag = ((dst >> 8) & 0x00ff00ff) * inv;
+    ag = (ag + ((ag >> 8) & 0x00ff00ff) + 0x00800080) & 0xff00ff00;
+    return src + rb + ag;
+}
+
+// Largest-Triangle-Three-Buckets: первая и последняя точки сохраняются, из каждого из остальных
+// threshold - 2 равных кусков берётся точка, образующая наибольший треугольник с предыдущей
+// выбранной и средним следующего куска.
+void downsampleLttb(const double *x, const double *y, int n, int threshold, QVector<QPointF> &out)
+{
+    out.reserve(threshold);
+    out.append(QPointF(x[0], y[0]));
+
+    const double bucket = static_cast<double>(n - 2) / (threshold - 2);
+    int a = 0;
+    for (int i = 0; i < threshold - 2; ++i)
+    {
+        const int nextBegin = static_cast<int>((i + 1) * bucket) + 1;
+        const int nextEnd = std::min(static_cast<int>((i + 2) * bucket) + 1, n);
+        double avgX = 0.0;
+        double avgY = 0.0;
+        for (int k = nextBegin; k < nextEnd; ++k)
+        {
+            avgX += x[k];
+            avgY += y[k];
+        }
+        const int nextCount = std::max(nextEnd - nextBegin, 1);
+        avgX /= nextCount;
+        avgY /= nextCount;
+
+        const int begin = static_cast<int>(i * bucket) + 1;
+        const int end = std::min(static_cast<int>((i + 1) * bucket) + 1, n - 1);
+        double bestArea = -1.0;
+        int best = begin;
+        for (int k = begin; k < end; ++k)
+        {
+            const double area = std::abs((x[a] - avgX) * (y[k] - y[a]) - (x[a] - x[k]) * (avgY - y[a]));
+            if (area > bestArea)
+            {
+                bestArea = area;
+                best = k;
+            }
+        }
+        out.append(QPointF(x[best], y[best]));
+        a = best;
+    }
+
+    out.append(QPointF(x[n - 1], y[n - 1]));
+}
+
+void blendSprite(uchar *bits, qsizetype bytesPerLine, int width, int height, const QImage &sprite, int cx, int cy)
+{
+    const int x0 = cx - sprite.width() / 2;
+    const int y0 = cy - sprite.height() / 2;
+    const int sx0 = std::max(0, -x0);
+    const int sy0 = std::max(0, -y0);
+    const int sx1 = std::min(sprite.width(), width - x0);
+    const int sy1 = std::min(sprite.height(), height - y0);
+
+    for (int sy = sy0; sy < sy1; ++sy)
+    {
+        const auto *src = reinterpret_cast<const QRgb *>(sprite.constScanLine(sy));
+        auto *dst = reinterpret_cast<QRgb *>(bits + (y0 + sy) * bytesPerLine) + x0;
+        for (int sx = sx0; sx < sx1; ++sx)
+        {
+            const QRgb s = src[sx];
+            const int a = qAlpha(s);
+            if (a == 255)
+            {
+                dst[sx] = s;
+            }
+            else if (a != 0)
+            {
+                dst[sx] = blendOver(s, dst[sx]);
+            }
+        }
+    }
+}
+}
+
 QCPScatterStyle::QCPScatterStyle(QCPScatterStyle::ScatterShape shape, const QPen &pen,
                                  const QBrush &brush, double size)
     : m_shape(shape), m_pen(pen), m_brush(brush), m_size(size)
@@ -56,6 +146,16 @@ void QCPGraph::setData(const QVector<double> &x, const QVector<double> &y)
 {
     m_x = x;
     m_y = y;
+    m_lineCacheValid = false;
+}
+
+void QCPGraph::setData(const double *x, const double *y, int count)
+{
+    m_x.resize(count);
+    m_y.resize(count);
+    std::copy(x, x + count, m_x.begin());
+    std::copy(y, y + count, m_y.begin());
+    m_lineCacheValid = false;
 }
 
 const QVector<double> &QCPGraph::dataX() const
@@ -101,6 +201,7 @@ QCPGraph::LineStyle QCPGraph::lineStyle() const
 void QCPGraph::setScatterStyle(const QCPScatterStyle &style)
 {
     m_scatterStyle = style;
+    m_sprite = QImage();
 }
 
 const QCPScatterStyle &QCPGraph::scatterStyle() const
@@ -108,6 +209,250 @@ const QCPScatterStyle &QCPGraph::scatterStyle() const
     return m_scatterStyle;
 }
 
+void QCPGraph::setChannelFillGraph(QCPGraph *target)
+{
+    m_channelFillGraph = (target == this) ? nullptr : target;
+}
+
+QCPGraph *QCPGraph::channelFillGraph() const
+{
+    return m_channelFillGraph;
+}
+
+void QCPGraph::setAdaptiveSampling(bool enabled)
+{
+    m_adaptiveSampling = enabled;
+    m_lineCacheValid = false;
+}
+
+bool QCPGraph::adaptiveSampling() const
+{
+    return m_adaptiveSampling;
+}
+
+const QVector<QPointF> &QCPGraph::lineData(double xLower, double xUpper, int pixelWidth) const
+{
+    if (m_lineCacheValid && m_lineCacheLower == xLower && m_lineCacheUpper == xUpper &&
+        m_lineCacheWidth == pixelWidth)
+    {
+        return m_lineCache;
+    }
+    m_lineCacheValid = true;
+    m_lineCacheLower = xLower;
+    m_lineCacheUpper = xUpper;
+    m_lineCacheWidth = pixelWidth;
+    m_lineCache.clear();
+
+    const int count = static_cast<int>(std::min(m_x.size(), m_y.size()));
+    int first = 0;
+    int last = count;
+    const bool sorted = std::is_sorted(m_x.begin(), m_x.begin() + count);
+    if (sorted)
+    {
+        // Видимый кусок плюс по точке с каждой стороны, чтобы линия доходила до края.
+        first = static_cast<int>(std::lower_bound(m_x.begin(), m_x.begin() + count, xLower) - m_x.begin());
+        last = static_cast<int>(std::upper_bound(m_x.begin(), m_x.begin() + count, xUpper) - m_x.begin());
+        first = std::max(first - 1, 0);
+        last = std::min(last + 1, count);
+    }
+
+    const int visible = last - first;
+    const int threshold = std::max(2 * pixelWidth, 3);
+    if (m_adaptiveSampling && sorted && visible > threshold)
+    {
+        downsampleLttb(m_x.constData() + first, m_y.constData() + first, visible, threshold, m_lineCache);
+    }
+    else
+    {
+        m_lineCache.reserve(visible);
+        for (int i = first; i < last; ++i)
+        {
+            m_lineCache.append(QPointF(m_x[i], m_y[i]));
+        }
+    }
+    return m_lineCache;
+}
+
+const QImage &QCPGraph::scatterSprite(qreal devicePixelRatio) const
+{
+    if (!m_sprite.isNull() && m_spriteRatio == devicePixelRatio)
+    {
+        return m_sprite;
+    }
+
+    const QCPScatterStyle &style = m_scatterStyle;
+    const double extent = (style.size() + style.pen().widthF()) * devicePixelRatio;
+    const int side = static_cast<int>(std::ceil(extent)) | 1;
+    m_sprite = QImage(side, side, QImage::Format_ARGB32_Premultiplied);
+    m_sprite.fill(Qt::transparent);
+    m_spriteRatio = devicePixelRatio;
+
+    QPainter painter(&m_sprite);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    QPen pen = style.pen();
+    pen.setWidthF(pen.widthF() * devicePixelRatio);
+    painter.setPen(pen);
+    painter.setBrush(style.brush());
+
+    const QPointF center(side / 2.0, side / 2.0);
+    const double radius = style.size() / 2.0 * devicePixelRatio;
+    switch (style.shape())
+    {
+    case QCPScatterStyle::ssCircle:
+        painter.drawEllipse(center, radius, radius);
+        break;
+    case QCPScatterStyle::ssSquare:
+        painter.drawRect(QRectF(center.x() - radius, center.y() - radius, radius * 2, radius * 2));
+        break;
+    default:
+        break;
+    }
+    return m_sprite;
+}
+
+void QCPDensityMap::setRange(const QRectF &range)
+{
+    m_range = range;
+}
+
+const QRectF &QCPDensityMap::range() const
+{
+    return m_range;
+}
+
+void QCPDensityMap::setSize(int columns, int rows)
+{
+    columns = std::max(columns, 0);
+    rows = std::max(rows, 0);
+    if (columns != m_columns || rows != m_rows)
+    {
+        m_columns = columns;
+        m_rows = rows;
+        m_imageDirty = true;
+    }
+}
+
+int QCPDensityMap::columns() const
+{
+    return m_columns;
+}
+
+int QCPDensityMap::rows() const
+{
+    return m_rows;
+}
+
+void QCPDensityMap::setChannelCount(int channels)
+{
+    m_channels.resize(static_cast<std::size_t>(std::max(channels, 0)));
+    m_imageDirty = true;
+}
+
+int QCPDensityMap::channelCount() const
+{
+    return static_cast<int>(m_channels.size());
+}
+
+void QCPDensityMap::setChannelColor(int channel, const QColor &color)
+{
+    if (channel >= 0 && channel < channelCount())
+    {
+        m_channels[static_cast<std::size_t>(channel)].color = color;
+        m_imageDirty = true;
+    }
+}
+
+void QCPDensityMap::setChannelData(int channel, const QVector<quint32> &counts)
+{
+    if (channel >= 0 && channel < channelCount())
+    {
+        m_channels[static_cast<std::size_t>(channel)].counts = counts;
+        m_imageDirty = true;
+    }
+}
+
+void QCPDensityMap::setChannelData(int channel, const quint32 *counts, int count)
+{
+    if (channel >= 0 && channel < channelCount())
+    {
+        QVector<quint32> &dst = m_channels[static_cast<std::size_t>(channel)].counts;
+        dst.resize(count);
+        std::copy(counts, counts + count, dst.begin());
+        m_imageDirty = true;
+    }
+}
+
+void QCPDensityMap::setVisible(bool visible)
+{
+    m_visible = visible;
+}
+
+bool QCPDensityMap::visible() const
+{
+    return m_visible;
+}
+
+const QImage &QCPDensityMap::image() const
+{
+    if (!m_imageDirty)
+    {
+        return m_image;
+    }
+    m_imageDirty = false;
+
+    if (m_columns == 0 || m_rows == 0)
+    {
+        m_image = QImage();
+        return m_image;
+    }
+    if (m_image.width() != m_columns || m_image.height() != m_rows)
+    {
+        m_image = QImage(m_columns, m_rows, QImage::Format_ARGB32_Premultiplied);
+    }
+    m_image.fill(Qt::transparent);
+
+    const int cells = m_columns * m_rows;
+    std::vector<double> norm(m_channels.size(), 0.0);
+    for (std::size_t c = 0; c < m_channels.size(); ++c)
+    {
+        const QVector<quint32> &counts = m_channels[c].counts;
+        const quint32 peak = counts.size() >= cells ? *std::max_element(counts.begin(), counts.begin() + cells) : 0;
+        norm[c] = peak > 0 ? 1.0 / std::log1p(static_cast<double>(peak)) : 0.0;
+    }
+
+    for (int row = 0; row < m_rows; ++row)
+    {
+        auto *line = reinterpret_cast<QRgb *>(m_image.scanLine(m_rows - 1 - row));
+        for (int col = 0; col < m_columns; ++col)
+        {
+            const int cell = row * m_columns + col;
+            double r = 1.0;
+            double g = 1.0;
+            double b = 1.0;
+            bool any = false;
+            for (std::size_t c = 0; c < m_channels.size(); ++c)
+            {
+                if (norm[c] == 0.0 || m_channels[c].counts[cell] == 0)
+                {
+                    continue;
+                }
+                any = true;
+                const double t = std::log1p(static_cast<double>(m_channels[c].counts[cell])) * norm[c];
+                const QColor &color = m_channels[c].color;
+                r *= 1.0 - t * (1.0 - color.redF());
+                g *= 1.0 - t * (1.0 - color.greenF());
+                b *= 1.0 - t * (1.0 - color.blueF());
+            }
+            if (any)
+            {
+                line[col] = qRgb(static_cast<int>(r * 255.0 + 0.5), static_cast<int>(g * 255.0 + 0.5),
+                                 static_cast<int>(b * 255.0 + 0.5));
+            }
+        }
+    }
+    return m_image;
+}
+
 QCustomPlot::QCustomPlot(QWidget *parent) : QWidget(parent), xAxis(new QCPAxis), yAxis(new QCPAxis)
 {
     setMinimumSize(320, 200);
@@ -144,6 +489,21 @@ void QCustomPlot::clearGraphs()
     m_graphs.clear();
 }
 
+QCPDensityMap *QCustomPlot::addDensityMap()
+{
+    m_densityMaps.push_back(std::make_unique<QCPDensityMap>());
+    return m_densityMaps.back().get();
+}
+
+QCPDensityMap *QCustomPlot::densityMap(int index) const
+{
+    if (index < 0 || static_cast<size_t>(index) >= m_densityMaps.size())
+    {
+        return nullptr;
+    }
+    return m_densityMaps[static_cast<size_t>(index)].get();
+}
+
 void QCustomPlot::replot()
 {
     update();
@@ -197,6 +557,66 @@ void QCustomPlot::setBackground(const QBrush &brush)
     m_background = brush;
 }
 
+void QCustomPlot::setRasterScatterThreshold(int points)
+{
+    m_rasterScatterThreshold = std::max(points, 0);
+}
+
+int QCustomPlot::rasterScatterThreshold() const
+{
+    return m_rasterScatterThreshold;
+}
+
+void QCustomPlot::drawScatterRaster(QPainter &painter, const QCPGraph &graph, const QRectF &pr, double xLower,
+                                    double xSpan, double yLower, double ySpan)
+{
+    const qreal ratio = devicePixelRatioF();
+    const int width = std::max(1, static_cast<int>(std::ceil(pr.width() * ratio)));
+    const int height = std::max(1, static_cast<int>(std::ceil(pr.height() * ratio)));
+    if (m_scatterLayer.width() != width || m_scatterLayer.height() != height)
+    {
+        m_scatterLayer = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+    }
+    m_scatterLayer.setDevicePixelRatio(ratio);
+    m_scatterLayer.fill(Qt::transparent);
+
+    const std::size_t pixels = static_cast<std::size_t>(width) * height;
+    m_pixelMask.assign((pixels + 63) / 64, 0);
+
+    const QImage &sprite = graph.scatterSprite(ratio);
+    uchar *bits = m_scatterLayer.bits();
+    const qsizetype bytesPerLine = m_scatterLayer.bytesPerLine();
+
+    const double kx = width / xSpan;
+    const double ky = height / ySpan;
+    const auto &xs = graph.dataX();
+    const auto &ys = graph.dataY();
+    const int count = static_cast<int>(std::min(xs.size(), ys.size()));
+    for (int i = 0; i < count; ++i)
+    {
+        const double fx = (xs[i] - xLower) * kx;
+        const double fy = height - (ys[i] - yLower) * ky;
+        // Точки ровно на правой или нижней границе диапазона (агенты у стены) попадают в крайний пиксель.
+        if (!(fx >= 0.0 && fx <= width && fy >= 0.0 && fy <= height))
+        {
+            continue;
+        }
+        const int px = std::min(static_cast<int>(fx), width - 1);
+        const int py = std::min(static_cast<int>(fy), height - 1);
+        const std::size_t pixel = static_cast<std::size_t>(py) * width + px;
+        std::uint64_t &word = m_pixelMask[pixel >> 6];
+        const std::uint64_t bit = std::uint64_t{1} << (pixel & 63);
+        if ((word & bit) != 0)
+        {
+            continue;
+        }
+        word |= bit;
+        blendSprite(bits, bytesPerLine, width, height, sprite, px, py);
+    }
+
+    painter.drawImage(pr.topLeft(), m_scatterLayer);
+}
+
 QRectF QCustomPlot::plotRect() const
 {
     const int left = 55;
@@ -232,6 +652,23 @@ void QCustomPlot::paintEvent(QPaintEvent *event)
         const double sy = pr.bottom() - (y - yLower) / ySpan * pr.height();
         return {sx, sy};
     };
+    const int pixelWidth = std::max(1, static_cast<int>(pr.width()));
+
+    for (const auto &map : m_densityMaps)
+    {
+        const QImage &image = map->image();
+        if (!map->visible() || image.isNull())
+        {
+            continue;
+        }
+        const QRectF &r = map->range();
+        const QRectF target(toScreen(r.left(), r.bottom()), toScreen(r.right(), r.top()));
+        painter.save();
+        painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
+        painter.setClipRect(pr);
+        painter.drawImage(target.normalized(), image);
+        painter.restore();
+    }
 
     for (const auto &g : m_graphs)
     {
@@ -242,22 +679,47 @@ void QCustomPlot::paintEvent(QPaintEvent *event)
             continue;
         }
 
+        if (const QCPGraph *target = g->channelFillGraph(); target != nullptr && g->brush().style() != Qt::NoBrush)
+        {
+            const QVector<QPointF> &upper = g->lineData(xLower, xUpper, pixelWidth);
+            const QVector<QPointF> &lower = target->lineData(xLower, xUpper, pixelWidth);
+            QPolygonF channel;
+            channel.reserve(upper.size() + lower.size());
+            for (const QPointF &p : upper)
+            {
+                channel.append(toScreen(p.x(), p.y()));
+            }
+            for (auto it = lower.crbegin(); it != lower.crend(); ++it)
+            {
+                channel.append(toScreen(it->x(), it->y()));
+            }
+            painter.setPen(Qt::NoPen);
+            painter.setBrush(g->brush());
+            painter.drawPolygon(channel);
+        }
+
         painter.setPen(g->pen());
         painter.setBrush(g->brush());
 
         if (g->lineStyle() == QCPGraph::lsLine && xs.size() > 1)
         {
+            const QVector<QPointF> &points = g->lineData(xLower, xUpper, pixelWidth);
             QPolygonF poly;
-            poly.reserve(xs.size());
-            for (int i = 0; i < xs.size() && i < ys.size(); ++i)
+            poly.reserve(points.size());
+            for (const QPointF &p : points)
             {
-                poly.append(toScreen(xs[i], ys[i]));
+                poly.append(toScreen(p.x(), p.y()));
             }
             painter.drawPolyline(poly);
         }
 
         const auto &scatter = g->scatterStyle();
-        if (scatter.shape() != QCPScatterStyle::ssNone)
+        if (scatter.shape() != QCPScatterStyle::ssNone && m_rasterScatterThreshold > 0 &&
+            std::min(xs.size(), ys.size()) >= m_rasterScatterThreshold)
+        {
+            drawScatterRaster(painter, *g, pr, xLower, xSpan, yLower, ySpan);
+        }
+        else if (scatter.shape() != QCPScatterStyle::ssNone)
         {
             painter.setPen(scatter.pen());
             painter.setBrush(scatter.brush());
@@ -1,14 +1,18 @@
 #pragma once
 
 #include <QBrush>
+#include <QImage>
 #include <QPen>
+#include <QPointF>
 #include <QString>
 #include <QVector>
 #include <QWidget>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 class QCPAxis;
+class QPainter;
 
 class QCPScatterStyle
 {
@@ -54,6 +58,8 @@ public:
     QCPGraph();
 
     void setData(const QVector<double> &x, const QVector<double> &y);
+    // Копирует count точек в собственные массивы графика, переиспользуя их ёмкость.
+    void setData(const double *x, const double *y, int count);
     const QVector<double> &dataX() const;
     const QVector<double> &dataY() const;
 
@@ -69,6 +75,20 @@ public:
     void setScatterStyle(const QCPScatterStyle &style);
     const QCPScatterStyle &scatterStyle() const;
 
+    void setChannelFillGraph(QCPGraph *target);
+    QCPGraph *channelFillGraph() const;
+
+    // Линия по данным, упорядоченным по X, при отрисовке прореживается LTTB примерно до двух точек
+    // на пиксель ширины в видимом диапазоне.
+    void setAdaptiveSampling(bool enabled);
+    bool adaptiveSampling() const;
+
+    // Точки линии в координатах данных; кэшируются, пока не изменились данные, диапазон или ширина.
+    const QVector<QPointF> &lineData(double xLower, double xUpper, int pixelWidth) const;
+
+    // Маркер, заранее отрисованный в картинку для растрового пути; пересобирается при смене стиля.
+    const QImage &scatterSprite(qreal devicePixelRatio) const;
+
 private:
     QVector<double> m_x;
     QVector<double> m_y;
@@ -76,6 +96,58 @@ private:
     QBrush m_brush{Qt::NoBrush};
     LineStyle m_lineStyle{lsLine};
     QCPScatterStyle m_scatterStyle;
+    QCPGraph *m_channelFillGraph{nullptr};
+
+    bool m_adaptiveSampling{true};
+
+    mutable QImage m_sprite;
+    mutable qreal m_spriteRatio{0.0};
+
+    mutable QVector<QPointF> m_lineCache;
+    mutable bool m_lineCacheValid{false};
+    mutable double m_lineCacheLower{0.0};
+    mutable double m_lineCacheUpper{0.0};
+    mutable int m_lineCacheWidth{0};
+};
+
+// Двумерная гистограмма в нескольких цветовых каналах (например, люди и зомби). Строка 0 — нижняя
+// по оси Y. Насыщенность канала в ячейке растёт как log(1 + n), каналы смешиваются вычитанием цвета.
+class QCPDensityMap
+{
+public:
+    void setRange(const QRectF &range);
+    const QRectF &range() const;
+
+    void setSize(int columns, int rows);
+    int columns() const;
+    int rows() const;
+
+    void setChannelCount(int channels);
+    int channelCount() const;
+    void setChannelColor(int channel, const QColor &color);
+    void setChannelData(int channel, const QVector<quint32> &counts);
+    void setChannelData(int channel, const quint32 *counts, int count);
+
+    void setVisible(bool visible);
+    bool visible() const;
+
+    const QImage &image() const;
+
+private:
+    struct Channel
+    {
+        QColor color;
+        QVector<quint32> counts;
+    };
+
+    QRectF m_range;
+    int m_columns{0};
+    int m_rows{0};
+    std::vector<Channel> m_channels;
+    bool m_visible{true};
+
+    mutable QImage m_image;
+    mutable bool m_imageDirty{true};
 };
 
 class QCustomPlot : public QWidget
@@ -90,6 +162,10 @@ public:
     QCPGraph *graph(int index) const;
     int graphCount() const;
     void clearGraphs();
+
+    // Карты плотности рисуются под графиками.
+    QCPDensityMap *addDensityMap();
+    QCPDensityMap *densityMap(int index) const;
     void replot();
     void rescaleAxes();
 
@@ -98,14 +174,27 @@ public:
 
     void setBackground(const QBrush &brush);
 
+    // Графики с числом точек не меньше порога рисуются растром: каждая точка попадает в пиксель
+    // слоя, повторные точки в том же пикселе отбрасываются, маркер копируется готовым спрайтом.
+    // 0 — растровый путь выключен.
+    void setRasterScatterThreshold(int points);
+    int rasterScatterThreshold() const;
+
 protected:
     void paintEvent(QPaintEvent *event) override;
 
 private:
     QRectF plotRect() const;
+    void drawScatterRaster(QPainter &painter, const QCPGraph &graph, const QRectF &pr, double xLower, double xSpan,
+                           double yLower, double ySpan);
 
     std::vector<std::unique_ptr<QCPGraph>> m_graphs;
+    std::vector<std::unique_ptr<QCPDensityMap>> m_densityMaps;
     QBrush m_background{Qt::white};
+    int m_rasterScatterThreshold{20000};
+
+    QImage m_scatterLayer;
+    std::vector<std::uint64_t> m_pixelMask;
 };
 
 class QCPAxis
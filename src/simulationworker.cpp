@@ -0,0 +1,242 @@
+#include "simulationworker.h"
+
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr int kStepIntervalMs = 60;
+constexpr qint64 kFrameBudgetNs = 16'000'000;
+constexpr qint64 kPublishIntervalMs = 15;
+constexpr qint64 kBatchIntervalMs = 50;
+constexpr int kDensityColumns = 240;
+
+void copyRange(const std::vector<double> &src, AgentIndex begin, AgentIndex end, std::vector<double> &dst)
+{
+    dst.resize(end - begin);
+    std::copy(src.begin() + begin, src.begin() + end, dst.begin());
+}
+}
+
+SimulationWorker::SimulationWorker(QObject *parent) : QObject(parent), m_timer(new QTimer(this))
+{
+    qRegisterMetaType<World::StepMetrics>("World::StepMetrics");
+    qRegisterMetaType<QVector<World::StepMetrics>>("QVector<World::StepMetrics>");
+
+    m_timer->setInterval(kStepIntervalMs);
+    connect(m_timer, &QTimer::timeout, this, &SimulationWorker::onTick);
+    m_sincePublish.start();
+    m_sinceFlush.start();
+}
+
+TripleBuffer<WorldSnapshot> &SimulationWorker::snapshots()
+{
+    return m_snapshots;
+}
+
+void SimulationWorker::applyParams(const SimulationParams &params)
+{
+    m_dt = params.dt;
+    m_world.setDefaultBiteRadius(params.biteRadius);
+    m_world.setIncubationTime(params.incubation);
+    m_world.setPerceptionRadius(params.perception);
+    m_world.setPursuitMode(params.pursuit);
+    m_world.setThreadCount(params.threads);
+    setStepsPerTick(params.stepsPerTick);
+    setDensityThreshold(params.densityThreshold);
+}
+
+void SimulationWorker::setDensityThreshold(int agents)
+{
+    m_densityThreshold = std::max(agents, 0);
+}
+
+void SimulationWorker::setStepsPerTick(int steps)
+{
+    m_stepsPerTick = std::max(steps, 0);
+    // В режиме «максимум» таймер срабатывает при каждом простое цикла событий, между тактами
+    // успевают пройти команды из GUI.
+    m_timer->setInterval(m_stepsPerTick > 0 ? kStepIntervalMs : 0);
+}
+
+void SimulationWorker::startRecording(const QString &path)
+{
+    stopRecording();
+    if (!m_recorder.open(path, m_world))
+    {
+        emit recordingChanged(false, m_recorder.errorString());
+        return;
+    }
+    if (!m_recorder.capture(m_world))
+    {
+        stopRecording();
+        return;
+    }
+    emit recordingChanged(true, QString());
+}
+
+void SimulationWorker::stopRecording()
+{
+    if (m_recorder.isOpen())
+    {
+        const bool written = m_recorder.close();
+        emit recordingChanged(false, written ? QString() : m_recorder.errorString());
+    }
+}
+
+void SimulationWorker::reset(const SimulationParams &params)
+{
+    m_timer->stop();
+    // Запись относится к одному миру: новый мир начинает новый файл.
+    stopRecording();
+    m_pending.clear();
+
+    applyParams(params);
+    m_world.reset(params.humans, params.zombies, params.seed);
+
+    recordSample();
+    flushSamples(true);
+    publishSnapshot(true);
+    emit runningChanged(false);
+}
+
+void SimulationWorker::start(const SimulationParams &params)
+{
+    applyParams(params);
+    if (!m_timer->isActive())
+    {
+        m_sinceFlush.restart();
+        m_rateSteps = 0;
+        m_rateAgentSteps = 0.0;
+        m_timer->start();
+        emit runningChanged(true);
+    }
+}
+
+void SimulationWorker::pause()
+{
+    if (m_timer->isActive())
+    {
+        m_timer->stop();
+        emit runningChanged(false);
+    }
+    flushSamples(true);
+    publishSnapshot(true);
+    emit rateChanged(0.0, 0.0);
+}
+
+void SimulationWorker::onTick()
+{
+    if (m_stepsPerTick > 0)
+    {
+        for (int k = 0; k < m_stepsPerTick; ++k)
+        {
+            stepOnce();
+        }
+    }
+    else
+    {
+        QElapsedTimer budget;
+        budget.start();
+        do
+        {
+            stepOnce();
+        } while (budget.nsecsElapsed() < kFrameBudgetNs);
+    }
+
+    // Снимок и пачка — не чаще одного раза за такт, сколько бы шагов в нём ни было.
+    publishSnapshot(false);
+    flushSamples(false);
+}
+
+void SimulationWorker::stepOnce()
+{
+    m_rateAgentSteps += static_cast<double>(m_world.agents().size());
+    ++m_rateSteps;
+    m_world.step(m_dt);
+    recordSample();
+    if (m_recorder.isOpen() && !m_recorder.capture(m_world))
+    {
+        stopRecording();
+    }
+}
+
+void SimulationWorker::recordSample()
+{
+    m_pending.append(m_world.lastStepMetrics());
+}
+
+void SimulationWorker::publishSnapshot(bool force)
+{
+    if (!force && m_sincePublish.elapsed() < kPublishIntervalMs)
+    {
+        return;
+    }
+    m_sincePublish.restart();
+
+    const AgentStore &agents = m_world.agents();
+    WorldSnapshot &snap = m_snapshots.writeBuffer();
+    snap.time = m_world.time();
+    snap.bounds = m_world.bounds();
+
+    const AgentIndex hBegin = agents.typeBegin(ObjType::Human);
+    const AgentIndex hEnd = agents.typeEnd(ObjType::Human);
+    const AgentIndex zBegin = agents.typeBegin(ObjType::Zombie);
+    const AgentIndex zEnd = agents.typeEnd(ObjType::Zombie);
+
+    snap.density = m_densityThreshold > 0 && agents.size() >= static_cast<std::size_t>(m_densityThreshold);
+    if (snap.density)
+    {
+        const QRectF &b = snap.bounds;
+        const int rows = std::max(1, static_cast<int>(std::lround(kDensityColumns * b.height() / b.width())));
+        m_density.configure(b, kDensityColumns, rows);
+        snap.densityColumns = m_density.columns();
+        snap.densityRows = m_density.rows();
+
+        const auto cells = static_cast<int>(m_density.cellCount());
+        snap.humanDensity.resize(cells);
+        snap.zombieDensity.resize(cells);
+        m_density.bin(agents.xs().data() + hBegin, agents.ys().data() + hBegin, hEnd - hBegin,
+                      snap.humanDensity.data(), m_world.threadPool());
+        m_density.bin(agents.xs().data() + zBegin, agents.ys().data() + zBegin, zEnd - zBegin,
+                      snap.zombieDensity.data(), m_world.threadPool());
+
+        snap.humanX.clear();
+        snap.humanY.clear();
+        snap.zombieX.clear();
+        snap.zombieY.clear();
+    }
+    else
+    {
+        copyRange(agents.xs(), hBegin, hEnd, snap.humanX);
+        copyRange(agents.ys(), hBegin, hEnd, snap.humanY);
+        copyRange(agents.xs(), zBegin, zEnd, snap.zombieX);
+        copyRange(agents.ys(), zBegin, zEnd, snap.zombieY);
+        snap.humanDensity.clear();
+        snap.zombieDensity.clear();
+    }
+
+    m_snapshots.publish();
+}
+
+void SimulationWorker::flushSamples(bool force)
+{
+    if (m_pending.isEmpty() || (!force && m_sinceFlush.elapsed() < kBatchIntervalMs))
+    {
+        return;
+    }
+    const double seconds = static_cast<double>(m_sinceFlush.nsecsElapsed()) * 1e-9;
+    m_sinceFlush.restart();
+
+    emit metricsBatch(m_pending);
+    m_pending.clear();
+
+    if (seconds > 0.0 && m_rateSteps > 0)
+    {
+        emit rateChanged(static_cast<double>(m_rateSteps) / seconds, m_rateAgentSteps / seconds);
+    }
+    m_rateSteps = 0;
+    m_rateAgentSteps = 0.0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QObject>
+#include <QRectF>
+#include <QVector>
+#include <cstdint>
+#include <vector>
+
+#include "densitygrid.h"
+#include "trajectory.h"
+#include "triplebuffer.h"
+#include "world.h"
+
+class QTimer;
+
+// Слоты тройного буфера — обычные std::vector без общего владения: публикация перезаписывает
+// ёмкость слота на месте, а GUI копирует данные к себе, не разделяя буфер с потоком воркера.
+struct WorldSnapshot
+{
+    double time{0.0};
+    QRectF bounds;
+    std::vector<double> humanX;
+    std::vector<double> humanY;
+    std::vector<double> zombieX;
+    std::vector<double> zombieY;
+
+    // Начиная с порога численности вместо координат публикуется гистограмма плотности.
+    bool density{false};
+    int densityColumns{0};
+    int densityRows{0};
+    std::vector<quint32> humanDensity;
+    std::vector<quint32> zombieDensity;
+};
+
+struct SimulationParams
+{
+    int humans{40};
+    int zombies{5};
+    double dt{0.1};
+    double biteRadius{6.0};
+    // Средняя инкубация (время модели); 0 — превращение на шаге укуса.
+    double incubation{0.0};
+    // Радиус обзора людей; 0 — люди не убегают.
+    double perception{0.0};
+    World::PursuitMode pursuit{World::PursuitMode::Nearest};
+    int threads{1};
+    // 0 — за такт столько шагов, сколько помещается в бюджет кадра.
+    int stepsPerTick{1};
+    // Численность, с которой снимок несёт плотность вместо координат; 0 — никогда.
+    int densityThreshold{200000};
+    std::uint64_t seed{1};
+};
+
+Q_DECLARE_METATYPE(World::StepMetrics)
+
+// Владеет миром и крутит шаги в собственном потоке. Положения агентов публикуются через тройной
+// буфер (GUI читает его с частотой кадров), сводки шагов уходят пачками не чаще kBatchIntervalMs.
+// Все слоты вызываются через очередь событий потока воркера.
+class SimulationWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SimulationWorker(QObject *parent = nullptr);
+
+    TripleBuffer<WorldSnapshot> &snapshots();
+
+public slots:
+    void reset(const SimulationParams &params);
+    void start(const SimulationParams &params);
+    void pause();
+    void setStepsPerTick(int steps);
+    void setDensityThreshold(int agents);
+    void startRecording(const QString &path);
+    void stopRecording();
+
+signals:
+    void metricsBatch(const QVector<World::StepMetrics> &samples);
+    void rateChanged(double stepsPerSecond, double agentStepsPerSecond);
+    void runningChanged(bool running);
+    void recordingChanged(bool recording, const QString &error);
+
+private:
+    void onTick();
+    void stepOnce();
+    void applyParams(const SimulationParams &params);
+    void recordSample();
+    void publishSnapshot(bool force);
+    void flushSamples(bool force);
+
+    World m_world;
+    QTimer *m_timer;
+    double m_dt{0.1};
+    int m_stepsPerTick{1};
+    int m_densityThreshold{200000};
+    DensityGrid m_density;
+    TrajectoryRecorder m_recorder;
+
+    TripleBuffer<WorldSnapshot> m_snapshots;
+    QElapsedTimer m_sincePublish;
+    QElapsedTimer m_sinceFlush;
+    QVector<World::StepMetrics> m_pending;
+    long long m_rateSteps{0};
+    double m_rateAgentSteps{0.0};
+};
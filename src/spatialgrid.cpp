@@ -0,0 +1,234 @@
+#include "spatialgrid.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr int kMaxCellsPerAxis = 4096;
+constexpr double kAutoAgentsPerCell = 2.0;
+}
+
+void SpatialGrid::setCellSize(double size)
+{
+    if (size >= 0.0)
+    {
+        m_cellSize = size;
+    }
+}
+
+double SpatialGrid::cellSize() const
+{
+    return m_cellSize;
+}
+
+void SpatialGrid::beginBuild(const QRectF &bounds, std::size_t expectedCount)
+{
+    m_bounds = bounds;
+
+    const double width = std::max(bounds.width(), 1e-9);
+    const double height = std::max(bounds.height(), 1e-9);
+    double cell = m_cellSize;
+    if (cell <= 0.0)
+    {
+        const double count = static_cast<double>(std::max<std::size_t>(expectedCount, 1));
+        cell = std::sqrt(width * height * kAutoAgentsPerCell / count);
+    }
+    m_cols = std::clamp(static_cast<int>(std::ceil(width / cell)), 1, kMaxCellsPerAxis);
+    m_rows = std::clamp(static_cast<int>(std::ceil(height / cell)), 1, kMaxCellsPerAxis);
+    m_cellW = width / m_cols;
+    m_cellH = height / m_rows;
+
+    m_stageX.clear();
+    m_stageY.clear();
+    m_stageId.clear();
+    m_stageCell.clear();
+    m_stageX.reserve(expectedCount);
+    m_stageY.reserve(expectedCount);
+    m_stageId.reserve(expectedCount);
+    m_stageCell.reserve(expectedCount);
+}
+
+void SpatialGrid::add(double x, double y, std::uint32_t id)
+{
+    m_stageX.push_back(x);
+    m_stageY.push_back(y);
+    m_stageId.push_back(id);
+    m_stageCell.push_back(static_cast<std::uint32_t>(cellRow(y) * m_cols + cellColumn(x)));
+}
+
+void SpatialGrid::finishBuild()
+{
+    const std::size_t cellCount = static_cast<std::size_t>(m_cols) * m_rows;
+    m_cellStart.assign(cellCount + 1, 0);
+    for (std::uint32_t cell : m_stageCell)
+    {
+        ++m_cellStart[cell + 1];
+    }
+    for (std::size_t c = 0; c < cellCount; ++c)
+    {
+        m_cellStart[c + 1] += m_cellStart[c];
+    }
+
+    const std::size_t n = m_stageId.size();
+    m_x.resize(n);
+    m_y.resize(n);
+    m_id.resize(n);
+
+    m_cursor.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const std::uint32_t slot = m_cursor[m_stageCell[i]]++;
+        m_x[slot] = m_stageX[i];
+        m_y[slot] = m_stageY[i];
+        m_id[slot] = m_stageId[i];
+    }
+}
+
+std::size_t SpatialGrid::size() const
+{
+    return m_id.size();
+}
+
+void SpatialGrid::sortQueriesByCell(const QPointF *points, std::size_t count, BatchScratch &scratch) const
+{
+    scratch.order.resize(count);
+    for (std::size_t q = 0; q < count; ++q)
+    {
+        const auto cell = static_cast<std::uint64_t>(cellRow(points[q].y()) * m_cols + cellColumn(points[q].x()));
+        scratch.order[q] = (cell << 32) | q;
+    }
+    std::sort(scratch.order.begin(), scratch.order.end());
+}
+
+int SpatialGrid::cellColumn(double x) const
+{
+    const double c = std::floor((x - m_bounds.left()) / m_cellW);
+    if (!(c >= 0.0))
+    {
+        return 0;
+    }
+    return c >= m_cols ? m_cols - 1 : static_cast<int>(c);
+}
+
+int SpatialGrid::cellRow(double y) const
+{
+    const double r = std::floor((y - m_bounds.top()) / m_cellH);
+    if (!(r >= 0.0))
+    {
+        return 0;
+    }
+    return r >= m_rows ? m_rows - 1 : static_cast<int>(r);
+}
+
+void SpatialGrid::scanCell(int col, int row, double x, double y, std::uint32_t &bestId, double &bestDist) const
+{
+    const std::size_t cell = static_cast<std::size_t>(row) * m_cols + col;
+    for (std::uint32_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k)
+    {
+        const double d = std::hypot(m_x[k] - x, m_y[k] - y);
+        if (d < bestDist || (d == bestDist && m_id[k] < bestId))
+        {
+            bestDist = d;
+            bestId = m_id[k];
+        }
+    }
+}
+
+void SpatialGrid::appendCell(int col, int row, BatchScratch &scratch) const
+{
+    const std::size_t cell = static_cast<std::size_t>(row) * m_cols + col;
+    for (std::uint32_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k)
+    {
+        scratch.candX.push_back(m_x[k]);
+        scratch.candY.push_back(m_y[k]);
+        scratch.candId.push_back(m_id[k]);
+    }
+}
+
+void SpatialGrid::gatherRing(int cx, int cy, int ring, BatchScratch &scratch) const
+{
+    scratch.candX.clear();
+    scratch.candY.clear();
+    scratch.candId.clear();
+
+    const int r0 = std::max(cy - ring, 0);
+    const int r1 = std::min(cy + ring, m_rows - 1);
+    const int c0 = std::max(cx - ring, 0);
+    const int c1 = std::min(cx + ring, m_cols - 1);
+    for (int row = r0; row <= r1; ++row)
+    {
+        if (row == cy - ring || row == cy + ring)
+        {
+            for (int col = c0; col <= c1; ++col)
+            {
+                appendCell(col, row, scratch);
+            }
+            continue;
+        }
+        if (cx - ring >= 0)
+        {
+            appendCell(cx - ring, row, scratch);
+        }
+        if (ring > 0 && cx + ring < m_cols)
+        {
+            appendCell(cx + ring, row, scratch);
+        }
+    }
+}
+
+std::uint32_t SpatialGrid::nearest(double x, double y, double *outDistance) const
+{
+    std::uint32_t bestId = kNoEntry;
+    double bestDist = std::numeric_limits<double>::max();
+
+    if (!m_id.empty())
+    {
+        const int cx = cellColumn(x);
+        const int cy = cellRow(y);
+        const int maxRing = std::max({cx, m_cols - 1 - cx, cy, m_rows - 1 - cy});
+        const double ringStep = std::min(m_cellW, m_cellH);
+
+        for (int ring = 0; ring <= maxRing; ++ring)
+        {
+            const int r0 = std::max(cy - ring, 0);
+            const int r1 = std::min(cy + ring, m_rows - 1);
+            const int c0 = std::max(cx - ring, 0);
+            const int c1 = std::min(cx + ring, m_cols - 1);
+
+            for (int row = r0; row <= r1; ++row)
+            {
+                const bool edgeRow = (row == cy - ring) || (row == cy + ring);
+                if (edgeRow)
+                {
+                    for (int col = c0; col <= c1; ++col)
+                    {
+                        scanCell(col, row, x, y, bestId, bestDist);
+                    }
+                }
+                else
+                {
+                    if (cx - ring >= 0)
+                    {
+                        scanCell(cx - ring, row, x, y, bestId, bestDist);
+                    }
+                    if (ring > 0 && cx + ring < m_cols)
+                    {
+                        scanCell(cx + ring, row, x, y, bestId, bestDist);
+                    }
+                }
+            }
+
+            // Всё, что лежит дальше кольца ring, удалено не меньше чем на ring * ringStep.
+            if (bestId != kNoEntry && ring * ringStep > bestDist)
+            {
+                break;
+            }
+        }
+    }
+
+    if (outDistance != nullptr)
+    {
+        *outDistance = bestDist;
+    }
+    return bestId;
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <QRectF>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Равномерная сетка над прямоугольником мира. Точки хранятся отсортированными по ячейкам
+// (counting sort), поэтому обход ячейки — это проход по непрерывному куску массива.
+class SpatialGrid
+{
+public:
+    static constexpr std::uint32_t kNoEntry = std::numeric_limits<std::uint32_t>::max();
+
+    // 0 — размер ячейки подбирается при построении по числу точек (около двух на ячейку).
+    void setCellSize(double size);
+    double cellSize() const;
+
+    void beginBuild(const QRectF &bounds, std::size_t expectedCount);
+    void add(double x, double y, std::uint32_t id);
+    void finishBuild();
+
+    std::size_t size() const;
+
+    // Ближайшая точка (поиск расширяющимися кольцами). При равных расстояниях выигрывает меньший id,
+    // что совпадает с порядком полного перебора.
+    std::uint32_t nearest(double x, double y, double *outDistance = nullptr) const;
+
+    template <typename Fn>
+    void forEachInRadius(double x, double y, double radius, Fn &&fn) const;
+
+    // Рабочие буферы пакетных запросов; владеет вызывающий, после первого пакета не выделяются.
+    struct BatchScratch
+    {
+        // (ячейка << 32) | номер запроса, отсортированные по ячейке.
+        std::vector<std::uint64_t> order;
+        std::vector<double> candX;
+        std::vector<double> candY;
+        std::vector<std::uint32_t> candId;
+        // Лучшие кандидаты и ещё не решённые запросы текущей ячейки в nearestBatch.
+        std::vector<double> bestDist;
+        std::vector<std::uint32_t> bestId;
+        std::vector<std::uint32_t> pending;
+    };
+
+    // Упорядочивает запросы по ячейке, чтобы соседние запросы обходили одни и те же ячейки.
+    void sortQueriesByCell(const QPointF *points, std::size_t count, BatchScratch &scratch) const;
+
+    // Пакет запросов в радиусе: запросы одной ячейки собирают точки окрестности ячейки один раз и
+    // проверяют их общим проходом. fn(номер запроса, id, x, y); точки одного запроса приходят в том же
+    // порядке, что и у forEachInRadius, запросы — в порядке ячеек.
+    template <typename Fn>
+    void forEachInRadiusBatch(const QPointF *points, std::size_t count, double radius, BatchScratch &scratch,
+                              Fn &&fn) const;
+
+    // Пакет поисков ближайшей точки: запросы одной ячейки идут по кольцам вокруг неё вместе, каждое
+    // кольцо собирается в кандидаты один раз и проверяется общим проходом по ещё не решённым запросам.
+    // Ответы совпадают с nearest(). fn(номер запроса, id или kNoEntry), запросы — в порядке ячеек.
+    template <typename Fn>
+    void nearestBatch(const QPointF *points, std::size_t count, BatchScratch &scratch, Fn &&fn) const;
+
+private:
+    int cellColumn(double x) const;
+    int cellRow(double y) const;
+    void scanCell(int col, int row, double x, double y, std::uint32_t &bestId, double &bestDist) const;
+    void appendCell(int col, int row, BatchScratch &scratch) const;
+    // Кандидаты кольца ring вокруг ячейки (cx, cy) в том же порядке ячеек, что обходит nearest().
+    void gatherRing(int cx, int cy, int ring, BatchScratch &scratch) const;
+
+    double m_cellSize{0.0};
+    QRectF m_bounds;
+    int m_cols{0};
+    int m_rows{0};
+    double m_cellW{1.0};
+    double m_cellH{1.0};
+
+    std::vector<double> m_stageX;
+    std::vector<double> m_stageY;
+    std::vector<std::uint32_t> m_stageId;
+    std::vector<std::uint32_t> m_stageCell;
+
+    std::vector<std::uint32_t> m_cellStart;
+    std::vector<std::uint32_t> m_cursor;
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<std::uint32_t> m_id;
+};
+
+template <typename Fn>
+void SpatialGrid::forEachInRadius(double x, double y, double radius, Fn &&fn) const
+{
+    if (m_id.empty() || !(radius >= 0.0))
+    {
+        return;
+    }
+
+    const int c0 = cellColumn(x - radius);
+    const int c1 = cellColumn(x + radius);
+    const int r0 = cellRow(y - radius);
+    const int r1 = cellRow(y + radius);
+
+    for (int row = r0; row <= r1; ++row)
+    {
+        for (int col = c0; col <= c1; ++col)
+        {
+            const std::size_t cell = static_cast<std::size_t>(row) * m_cols + col;
+            for (std::uint32_t k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k)
+            {
+                if (std::hypot(m_x[k] - x, m_y[k] - y) <= radius)
+                {
+                    fn(m_id[k], m_x[k], m_y[k]);
+                }
+            }
+        }
+    }
+}
+
+template <typename Fn>
+void SpatialGrid::forEachInRadiusBatch(const QPointF *points, std::size_t count, double radius,
+                                       BatchScratch &scratch, Fn &&fn) const
+{
+    if (m_id.empty() || !(radius >= 0.0) || count == 0)
+    {
+        return;
+    }
+
+    sortQueriesByCell(points, count, scratch);
+    const std::vector<std::uint64_t> &order = scratch.order;
+
+    std::size_t run = 0;
+    while (run < count)
+    {
+        const std::uint32_t cell = static_cast<std::uint32_t>(order[run] >> 32);
+        std::size_t runEnd = run + 1;
+        while (runEnd < count && static_cast<std::uint32_t>(order[runEnd] >> 32) == cell)
+        {
+            ++runEnd;
+        }
+
+        // Окрестность всей ячейки запроса покрывает окрестность любой точки в ней.
+        const int col = static_cast<int>(cell % static_cast<std::uint32_t>(m_cols));
+        const int row = static_cast<int>(cell / static_cast<std::uint32_t>(m_cols));
+        const double left = m_bounds.left() + col * m_cellW;
+        const double top = m_bounds.top() + row * m_cellH;
+        const int c0 = cellColumn(left - radius);
+        const int c1 = cellColumn(left + m_cellW + radius);
+        const int r0 = cellRow(top - radius);
+        const int r1 = cellRow(top + m_cellH + radius);
+
+        scratch.candX.clear();
+        scratch.candY.clear();
+        scratch.candId.clear();
+        for (int r = r0; r <= r1; ++r)
+        {
+            for (int c = c0; c <= c1; ++c)
+            {
+                const std::size_t from = static_cast<std::size_t>(r) * m_cols + c;
+                for (std::uint32_t k = m_cellStart[from]; k < m_cellStart[from + 1]; ++k)
+                {
+                    scratch.candX.push_back(m_x[k]);
+                    scratch.candY.push_back(m_y[k]);
+                    scratch.candId.push_back(m_id[k]);
+                }
+            }
+        }
+
+        const std::size_t candidates = scratch.candId.size();
+        for (std::size_t i = run; i < runEnd; ++i)
+        {
+            const std::size_t q = static_cast<std::uint32_t>(order[i]);
+            const double x = points[q].x();
+            const double y = points[q].y();
+            for (std::size_t k = 0; k < candidates; ++k)
+            {
+                if (std::hypot(scratch.candX[k] - x, scratch.candY[k] - y) <= radius)
+                {
+                    fn(q, scratch.candId[k], scratch.candX[k], scratch.candY[k]);
+                }
+            }
+        }
+        run = runEnd;
+    }
+}
+
+template <typename Fn>
+void SpatialGrid::nearestBatch(const QPointF *points, std::size_t count, BatchScratch &scratch, Fn &&fn) const
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (m_id.empty())
+    {
+        for (std::size_t q = 0; q < count; ++q)
+        {
+            fn(q, kNoEntry);
+        }
+        return;
+    }
+
+    sortQueriesByCell(points, count, scratch);
+    const std::vector<std::uint64_t> &order = scratch.order;
+    const double ringStep = std::min(m_cellW, m_cellH);
+
+    std::size_t run = 0;
+    while (run < count)
+    {
+        const std::uint32_t cell = static_cast<std::uint32_t>(order[run] >> 32);
+        std::size_t runEnd = run + 1;
+        while (runEnd < count && static_cast<std::uint32_t>(order[runEnd] >> 32) == cell)
+        {
+            ++runEnd;
+        }
+
+        // Одиночному запросу собирать кандидатов незачем.
+        if (runEnd - run == 1)
+        {
+            const std::size_t q = static_cast<std::uint32_t>(order[run]);
+            fn(q, nearest(points[q].x(), points[q].y()));
+            run = runEnd;
+            continue;
+        }
+
+        // У всех запросов ячейки одни и те же кольца, поэтому и правило остановки то же, что у nearest().
+        const int cx = static_cast<int>(cell % static_cast<std::uint32_t>(m_cols));
+        const int cy = static_cast<int>(cell / static_cast<std::uint32_t>(m_cols));
+        const int maxRing = std::max({cx, m_cols - 1 - cx, cy, m_rows - 1 - cy});
+        const std::size_t queries = runEnd - run;
+        scratch.bestDist.assign(queries, std::numeric_limits<double>::max());
+        scratch.bestId.assign(queries, kNoEntry);
+        scratch.pending.resize(queries);
+        for (std::size_t i = 0; i < queries; ++i)
+        {
+            scratch.pending[i] = static_cast<std::uint32_t>(i);
+        }
+
+        for (int ring = 0; ring <= maxRing && !scratch.pending.empty(); ++ring)
+        {
+            gatherRing(cx, cy, ring, scratch);
+            const std::size_t candidates = scratch.candId.size();
+            std::size_t kept = 0;
+            for (std::uint32_t i : scratch.pending)
+            {
+                const QPointF &p = points[static_cast<std::uint32_t>(order[run + i])];
+                double best = scratch.bestDist[i];
+                std::uint32_t bestId = scratch.bestId[i];
+                for (std::size_t k = 0; k < candidates; ++k)
+                {
+                    const double d = std::hypot(scratch.candX[k] - p.x(), scratch.candY[k] - p.y());
+                    if (d < best || (d == best && scratch.candId[k] < bestId))
+                    {
+                        best = d;
+                        bestId = scratch.candId[k];
+                    }
+                }
+                scratch.bestDist[i] = best;
+                scratch.bestId[i] = bestId;
+                // Всё, что лежит дальше кольца ring, удалено не меньше чем на ring * ringStep.
+                if (!(bestId != kNoEntry && ring * ringStep > best))
+                {
+                    scratch.pending[kept++] = i;
+                }
+            }
+            scratch.pending.resize(kept);
+        }
+
+        for (std::size_t i = 0; i < queries; ++i)
+        {
+            fn(static_cast<std::size_t>(static_cast<std::uint32_t>(order[run + i])), scratch.bestId[i]);
+        }
+        run = runEnd;
+    }
+}
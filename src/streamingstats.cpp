@@ -0,0 +1,155 @@
+#include "streamingstats.h"
+
+#include <algorithm>
+#include <cmath>
+
+void RunningStats::add(double x)
+{
+    ++m_count;
+    const double delta = x - m_mean;
+    m_mean += delta / static_cast<double>(m_count);
+    m_m2 += delta * (x - m_mean);
+
+    if (m_count == 1)
+    {
+        m_min = x;
+        m_max = x;
+    }
+    else
+    {
+        m_min = std::min(m_min, x);
+        m_max = std::max(m_max, x);
+    }
+}
+
+std::size_t RunningStats::count() const
+{
+    return m_count;
+}
+
+double RunningStats::mean() const
+{
+    return m_mean;
+}
+
+double RunningStats::variance() const
+{
+    return m_count > 1 ? m_m2 / static_cast<double>(m_count - 1) : 0.0;
+}
+
+double RunningStats::stddev() const
+{
+    return std::sqrt(variance());
+}
+
+double RunningStats::min() const
+{
+    return m_min;
+}
+
+double RunningStats::max() const
+{
+    return m_max;
+}
+
+P2Quantile::P2Quantile(double p) : m_p(std::clamp(p, 0.0, 1.0))
+{
+    m_desired = {1.0, 1.0 + 2.0 * m_p, 1.0 + 4.0 * m_p, 3.0 + 2.0 * m_p, 5.0};
+    m_increment = {0.0, m_p / 2.0, m_p, (1.0 + m_p) / 2.0, 1.0};
+}
+
+void P2Quantile::add(double x)
+{
+    if (m_count < 5)
+    {
+        m_q[m_count++] = x;
+        if (m_count == 5)
+        {
+            std::sort(m_q.begin(), m_q.end());
+            m_n = {1.0, 2.0, 3.0, 4.0, 5.0};
+        }
+        return;
+    }
+    ++m_count;
+
+    int k = 0;
+    if (x < m_q[0])
+    {
+        m_q[0] = x;
+        k = 0;
+    }
+    else if (x >= m_q[4])
+    {
+        m_q[4] = std::max(m_q[4], x);
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while (k < 3 && x >= m_q[k + 1])
+        {
+            ++k;
+        }
+    }
+
+    for (int i = k + 1; i < 5; ++i)
+    {
+        m_n[i] += 1.0;
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        m_desired[i] += m_increment[i];
+    }
+
+    for (int i = 1; i <= 3; ++i)
+    {
+        const double d = m_desired[i] - m_n[i];
+        if ((d >= 1.0 && m_n[i + 1] - m_n[i] > 1.0) || (d <= -1.0 && m_n[i - 1] - m_n[i] < -1.0))
+        {
+            const int step = d > 0.0 ? 1 : -1;
+            const double candidate = parabolic(i, step);
+            if (m_q[i - 1] < candidate && candidate < m_q[i + 1])
+            {
+                m_q[i] = candidate;
+            }
+            else
+            {
+                m_q[i] = linear(i, step);
+            }
+            m_n[i] += step;
+        }
+    }
+}
+
+double P2Quantile::parabolic(int i, double d) const
+{
+    return m_q[i] + d / (m_n[i + 1] - m_n[i - 1]) *
+                        ((m_n[i] - m_n[i - 1] + d) * (m_q[i + 1] - m_q[i]) / (m_n[i + 1] - m_n[i]) +
+                         (m_n[i + 1] - m_n[i] - d) * (m_q[i] - m_q[i - 1]) / (m_n[i] - m_n[i - 1]));
+}
+
+double P2Quantile::linear(int i, int d) const
+{
+    return m_q[i] + d * (m_q[i + d] - m_q[i]) / (m_n[i + d] - m_n[i]);
+}
+
+std::size_t P2Quantile::count() const
+{
+    return m_count;
+}
+
+double P2Quantile::value() const
+{
+    if (m_count == 0)
+    {
+        return 0.0;
+    }
+    if (m_count < 5)
+    {
+        std::array<double, 5> sorted = m_q;
+        std::sort(sorted.begin(), sorted.begin() + static_cast<long>(m_count));
+        const auto rank = static_cast<std::size_t>(std::lround(m_p * static_cast<double>(m_count - 1)));
+        return sorted[rank];
+    }
+    return m_q[2];
+}
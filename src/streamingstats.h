@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+// Среднее и дисперсия по алгоритму Уэлфорда: одно наблюдение — O(1) времени и памяти.
+class RunningStats
+{
+public:
+    void add(double x);
+
+    std::size_t count() const;
+    double mean() const;
+    double variance() const;
+    double stddev() const;
+    double min() const;
+    double max() const;
+
+private:
+    std::size_t m_count{0};
+    double m_mean{0.0};
+    double m_m2{0.0};
+    double m_min{0.0};
+    double m_max{0.0};
+};
+
+// Потоковая оценка квантиля методом P² (Jain, Chlamtac): пять маркеров вместо хранения выборки.
+class P2Quantile
+{
+public:
+    explicit P2Quantile(double p = 0.5);
+
+    void add(double x);
+
+    std::size_t count() const;
+    double value() const;
+
+private:
+    double parabolic(int i, double d) const;
+    double linear(int i, int d) const;
+
+    double m_p;
+    std::size_t m_count{0};
+    std::array<double, 5> m_q{};
+    std::array<double, 5> m_n{};
+    std::array<double, 5> m_desired{};
+    std::array<double, 5> m_increment{};
+};
@@ -0,0 +1,175 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    const int total = std::max(threadCount, 1);
+    for (int i = 0; i < total; ++i)
+    {
+        m_queues.push_back(std::make_unique<TaskQueue>());
+    }
+
+    m_threads.reserve(static_cast<std::size_t>(total - 1));
+    for (int i = 1; i < total; ++i)
+    {
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &t : m_threads)
+    {
+        t.join();
+    }
+}
+
+int ThreadPool::threadCount() const
+{
+    return static_cast<int>(m_threads.size()) + 1;
+}
+
+int ThreadPool::hardwareThreads()
+{
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void ThreadPool::dispatch(const std::function<void(int worker)> &job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_active = static_cast<int>(m_threads.size());
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    job(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_active == 0; });
+    m_job = nullptr;
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t grain, const RangeFn &fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    grain = std::max<std::size_t>(grain, 1);
+    if (m_threads.empty() || count <= grain)
+    {
+        fn(0, count, 0);
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    const std::function<void(int)> job = [&](int worker) {
+        for (;;)
+        {
+            const std::size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+            if (begin >= count)
+            {
+                break;
+            }
+            fn(begin, std::min(begin + grain, count), worker);
+        }
+    };
+    dispatch(job);
+}
+
+void ThreadPool::runTasks(std::size_t count, const TaskFn &fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (m_threads.empty())
+    {
+        for (std::size_t task = 0; task < count; ++task)
+        {
+            fn(task, 0);
+        }
+        return;
+    }
+
+    for (std::size_t task = 0; task < count; ++task)
+    {
+        TaskQueue &queue = *m_queues[task % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+
+    const std::function<void(int)> job = [&](int worker) {
+        std::size_t task = 0;
+        while (popOrSteal(worker, task))
+        {
+            fn(task, worker);
+        }
+    };
+    dispatch(job);
+}
+
+bool ThreadPool::popOrSteal(int worker, std::size_t &task)
+{
+    {
+        TaskQueue &own = *m_queues[static_cast<std::size_t>(worker)];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    const std::size_t n = m_queues.size();
+    for (std::size_t k = 1; k < n; ++k)
+    {
+        TaskQueue &victim = *m_queues[(static_cast<std::size_t>(worker) + k) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int worker)
+{
+    std::uint64_t seen = 0;
+    for (;;)
+    {
+        const std::function<void(int)> *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop)
+            {
+                return;
+            }
+            seen = m_generation;
+            job = m_job;
+        }
+
+        (*job)(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_active == 0)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+}
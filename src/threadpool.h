@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков. Вызывающий поток работает как исполнитель 0.
+// parallelFor раздаёт куски диапазона через атомарный счётчик, runTasks раскладывает независимые
+// задачи по очередям исполнителей, а освободившийся исполнитель забирает работу из чужих очередей.
+class ThreadPool
+{
+public:
+    using RangeFn = std::function<void(std::size_t begin, std::size_t end, int worker)>;
+    using TaskFn = std::function<void(std::size_t task, int worker)>;
+
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int threadCount() const;
+
+    void parallelFor(std::size_t count, std::size_t grain, const RangeFn &fn);
+    void runTasks(std::size_t count, const TaskFn &fn);
+
+    static int hardwareThreads();
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    void dispatch(const std::function<void(int worker)> &job);
+    void workerLoop(int worker);
+    bool popOrSteal(int worker, std::size_t &task);
+
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<TaskQueue>> m_queues;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const std::function<void(int worker)> *m_job{nullptr};
+    std::uint64_t m_generation{0};
+    int m_active{0};
+    bool m_stop{false};
+};
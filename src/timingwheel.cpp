@@ -0,0 +1,95 @@
+#include "timingwheel.h"
+
+#include <algorithm>
+
+void TimingWheel::clear(std::uint64_t now)
+{
+    for (auto &level : m_slots)
+    {
+        for (std::vector<Entry> &slot : level)
+        {
+            slot.clear();
+        }
+    }
+    m_now = now;
+    m_size = 0;
+}
+
+std::uint64_t TimingWheel::now() const
+{
+    return m_now;
+}
+
+std::size_t TimingWheel::size() const
+{
+    return m_size;
+}
+
+bool TimingWheel::empty() const
+{
+    return m_size == 0;
+}
+
+void TimingWheel::schedule(std::uint32_t key, std::uint64_t due)
+{
+    insert({std::max(due, m_now + 1), key});
+    ++m_size;
+}
+
+void TimingWheel::insert(const Entry &entry)
+{
+    // Уровень — старшая группа бит, в которой срок расходится с текущим шагом.
+    const std::uint64_t diff = entry.due ^ m_now;
+    int level = 0;
+    while (level + 1 < kLevels && (diff >> (kSlotBits * (level + 1))) != 0)
+    {
+        ++level;
+    }
+    const std::size_t slot = (entry.due >> (kSlotBits * level)) & (kSlots - 1);
+    m_slots[static_cast<std::size_t>(level)][slot].push_back(entry);
+}
+
+void TimingWheel::cascade(int level)
+{
+    const std::size_t slot = (m_now >> (kSlotBits * level)) & (kSlots - 1);
+    // Ячейка забирается целиком до раскладки: дальний срок может вернуться в неё же.
+    m_scratch.clear();
+    m_scratch.swap(m_slots[static_cast<std::size_t>(level)][slot]);
+    for (const Entry &entry : m_scratch)
+    {
+        insert(entry);
+    }
+}
+
+void TimingWheel::advance(std::uint64_t to, std::vector<std::uint32_t> &due)
+{
+    while (m_now < to)
+    {
+        ++m_now;
+        if (m_size == 0)
+        {
+            // Пустое колесо ничего не раскладывает; шаги просто догоняются.
+            m_now = to;
+            break;
+        }
+
+        // Перенос в младших группах: сверху вниз раскладываются ячейки уровней, чья группа сменилась.
+        int top = 0;
+        while (top + 1 < kLevels && ((m_now >> (kSlotBits * top)) & (kSlots - 1)) == 0)
+        {
+            ++top;
+        }
+        for (int level = top; level > 0; --level)
+        {
+            cascade(level);
+        }
+
+        std::vector<Entry> &slot = m_slots[0][m_now & (kSlots - 1)];
+        for (const Entry &entry : slot)
+        {
+            due.push_back(entry.key);
+        }
+        m_size -= slot.size();
+        slot.clear();
+    }
+}
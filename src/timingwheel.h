@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Иерархическое колесо таймеров по номерам шагов (Varghese–Lauck): 4 уровня по 64 ячейки.
+// Запись лежит на уровне старшей 6-битной группы, в которой её срок отличается от текущего шага;
+// при переходе младшей группы через ноль ячейка следующего уровня раскладывается вниз. Поэтому
+// advance() трогает только записи, чей срок наступил, и изредка — одну ячейку старшего уровня.
+// Срок дальше 2^24 шагов ждёт на верхнем уровне и перекладывается при каждом его обороте.
+class TimingWheel
+{
+public:
+    struct Entry
+    {
+        std::uint64_t due;
+        std::uint32_t key;
+    };
+
+    // Очищает колесо; следующий advance() обработает шаг now + 1.
+    void clear(std::uint64_t now);
+    std::uint64_t now() const;
+    std::size_t size() const;
+    bool empty() const;
+
+    // Срок не позже текущего шага переносится на следующий.
+    void schedule(std::uint32_t key, std::uint64_t due);
+
+    // Продвигает колесо до шага to (обычно на один шаг) и дописывает в due ключи, срок которых наступил.
+    void advance(std::uint64_t to, std::vector<std::uint32_t> &due);
+
+    template <typename Fn>
+    void forEach(Fn &&fn) const;
+
+private:
+    static constexpr int kSlotBits = 6;
+    static constexpr std::size_t kSlots = std::size_t{1} << kSlotBits;
+    static constexpr int kLevels = 4;
+
+    void insert(const Entry &entry);
+    void cascade(int level);
+
+    std::uint64_t m_now{0};
+    std::size_t m_size{0};
+    std::array<std::array<std::vector<Entry>, kSlots>, kLevels> m_slots;
+    std::vector<Entry> m_scratch;
+};
+
+template <typename Fn>
+void TimingWheel::forEach(Fn &&fn) const
+{
+    for (const auto &level : m_slots)
+    {
+        for (const std::vector<Entry> &slot : level)
+        {
+            for (const Entry &entry : slot)
+            {
+                fn(entry.key, entry.due);
+            }
+        }
+    }
+}
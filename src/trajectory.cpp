@@ -0,0 +1,687 @@
+#include "trajectory.h"
+
+#include "world.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+constexpr char kFileMagic[4] = {'Z', 'T', 'R', 'J'};
+constexpr char kIndexMagic[4] = {'Z', 'I', 'D', 'X'};
+constexpr std::size_t kHeaderBytes = 64;
+constexpr std::size_t kFrameHeaderBytes = 24;
+constexpr std::size_t kTrailerBytes = 24;
+constexpr std::size_t kIndexEntryBytes = 16;
+constexpr double kQuantMax = 65535.0;
+
+enum FrameKind : std::uint8_t
+{
+    KeyFrame = 0,
+    DeltaFrame = 1
+};
+
+template <typename T>
+void put(std::vector<std::uint8_t> &out, T value)
+{
+    const std::size_t at = out.size();
+    out.resize(at + sizeof(T));
+    qToLittleEndian(value, out.data() + at);
+}
+
+void putF64(std::vector<std::uint8_t> &out, double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put<std::uint64_t>(out, bits);
+}
+
+template <typename T>
+T get(const uchar *p)
+{
+    return qFromLittleEndian<T>(p);
+}
+
+double getF64(const uchar *p)
+{
+    const std::uint64_t bits = get<std::uint64_t>(p);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void putVarint(std::vector<std::uint8_t> &out, std::uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+bool getVarint(const uchar *&p, const uchar *end, std::uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7)
+    {
+        const std::uint8_t byte = *p++;
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint32_t zigzag(std::int32_t v)
+{
+    return (static_cast<std::uint32_t>(v) << 1) ^ static_cast<std::uint32_t>(v >> 31);
+}
+
+std::int32_t unzigzag(std::uint32_t v)
+{
+    return static_cast<std::int32_t>(v >> 1) ^ -static_cast<std::int32_t>(v & 1);
+}
+
+// NaN проходит мимо обоих сравнений, а его приведение к целому — неопределённое поведение, поэтому
+// всё, что не больше нуля (и NaN), уходит в ноль.
+std::uint16_t quantize(double v, double origin, double scale)
+{
+    const double q = (v - origin) * scale + 0.5;
+    return static_cast<std::uint16_t>(!(q > 0.0) ? 0.0 : (q >= kQuantMax ? kQuantMax : q));
+}
+}
+
+TrajectoryRecorder::TrajectoryRecorder() = default;
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    close();
+}
+
+bool TrajectoryRecorder::open(const QString &path, const World &world, int keyframeInterval)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_agentCount = world.agents().nextId();
+    m_bounds = world.bounds();
+    m_scaleX = kQuantMax / std::max(m_bounds.width(), 1e-9);
+    m_scaleY = kQuantMax / std::max(m_bounds.height(), 1e-9);
+    m_keyframeInterval = std::max(keyframeInterval, 1);
+
+    std::vector<std::uint8_t> header;
+    header.reserve(kHeaderBytes);
+    header.insert(header.end(), std::begin(kFileMagic), std::end(kFileMagic));
+    put<std::uint32_t>(header, trajectory::kVersion);
+    put<std::uint32_t>(header, m_agentCount);
+    put<std::uint32_t>(header, static_cast<std::uint32_t>(m_keyframeInterval));
+    putF64(header, m_bounds.left());
+    putF64(header, m_bounds.top());
+    putF64(header, m_bounds.width());
+    putF64(header, m_bounds.height());
+    put<std::uint64_t>(header, world.seed());
+    header.resize(kHeaderBytes, 0);
+    if (m_file.write(reinterpret_cast<const char *>(header.data()), static_cast<qint64>(header.size())) !=
+        static_cast<qint64>(header.size()))
+    {
+        m_error = m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    m_offsets.clear();
+    m_steps.clear();
+    m_previous = Frame();
+    m_stop = false;
+    m_failed = false;
+    m_forceKey = false;
+    m_skipped = 0;
+    m_error.clear();
+    m_open = true;
+    m_writer = std::thread([this] { writerLoop(); });
+    return true;
+}
+
+bool TrajectoryRecorder::isOpen() const
+{
+    return m_open;
+}
+
+QString TrajectoryRecorder::errorString() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+void TrajectoryRecorder::fail(const QString &error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_failed)
+    {
+        m_failed = true;
+        m_error = error;
+    }
+}
+
+std::uint64_t TrajectoryRecorder::skippedFrames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_skipped;
+}
+
+bool TrajectoryRecorder::capture(const World &world)
+{
+    if (!m_open)
+    {
+        return false;
+    }
+
+    std::unique_ptr<Frame> frame;
+    bool key = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_failed)
+        {
+            return false;
+        }
+        // Диск отстал: кадр пропускается, чтобы не тормозить шаг. Дельта следующего кадра считалась бы
+        // через разрыв, поэтому он пишется ключевым.
+        if (m_queue.size() >= static_cast<std::size_t>(trajectory::kMaxQueuedFrames))
+        {
+            ++m_skipped;
+            m_forceKey = true;
+            return true;
+        }
+        key = m_forceKey;
+        m_forceKey = false;
+        if (!m_spare.empty())
+        {
+            frame = std::move(m_spare.back());
+            m_spare.pop_back();
+        }
+    }
+    if (!frame)
+    {
+        frame = std::make_unique<Frame>();
+    }
+
+    frame->step = world.stepIndex();
+    frame->time = world.time();
+    frame->key = key;
+    frame->x.resize(m_agentCount);
+    frame->y.resize(m_agentCount);
+    frame->types.resize(m_agentCount);
+
+    const AgentStore &agents = world.agents();
+    const std::size_t count = agents.size();
+    const AgentId *ids = agents.ids().data();
+    const double *xs = agents.xs().data();
+    const double *ys = agents.ys().data();
+    const ObjType *types = agents.types().data();
+    const double left = m_bounds.left();
+    const double top = m_bounds.top();
+    for (std::size_t slot = 0; slot < count; ++slot)
+    {
+        const AgentId id = ids[slot];
+        if (id < m_agentCount)
+        {
+            frame->x[id] = quantize(xs[slot], left, m_scaleX);
+            frame->y[id] = quantize(ys[slot], top, m_scaleY);
+            frame->types[id] = static_cast<std::uint8_t>(types[slot]);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(frame));
+    }
+    m_wake.notify_one();
+    return true;
+}
+
+bool TrajectoryRecorder::close()
+{
+    if (!m_open)
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+    m_open = false;
+
+    // Без таблицы кадров читатель проходит файл по заголовкам и не видит в нём законченную запись.
+    if (m_failed)
+    {
+        m_file.close();
+        return false;
+    }
+
+    std::vector<std::uint8_t> tail;
+    tail.reserve(m_offsets.size() * kIndexEntryBytes + kTrailerBytes);
+    const auto indexOffset = static_cast<std::uint64_t>(m_file.pos());
+    for (std::size_t i = 0; i < m_offsets.size(); ++i)
+    {
+        put<std::uint64_t>(tail, m_offsets[i]);
+        put<std::uint64_t>(tail, m_steps[i]);
+    }
+    put<std::uint64_t>(tail, m_offsets.size());
+    put<std::uint64_t>(tail, indexOffset);
+    tail.insert(tail.end(), std::begin(kIndexMagic), std::end(kIndexMagic));
+    put<std::uint32_t>(tail, 0);
+    const bool written =
+        m_file.write(reinterpret_cast<const char *>(tail.data()), static_cast<qint64>(tail.size())) ==
+            static_cast<qint64>(tail.size()) &&
+        m_file.flush();
+    if (!written)
+    {
+        fail(m_file.errorString());
+    }
+    m_file.close();
+    return written;
+}
+
+void TrajectoryRecorder::writerLoop()
+{
+    for (;;)
+    {
+        std::unique_ptr<Frame> frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty())
+            {
+                return;
+            }
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        // После ошибки очередь только опустошается: дописывать дельты к оборванному кадру нельзя.
+        bool failed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            failed = m_failed;
+        }
+        if (!failed && !writeFrame(*frame))
+        {
+            fail(m_file.errorString());
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_spare.push_back(std::move(frame));
+    }
+}
+
+bool TrajectoryRecorder::writeFrame(const Frame &frame)
+{
+    const bool key = frame.key || m_offsets.size() % static_cast<std::size_t>(m_keyframeInterval) == 0;
+    const std::size_t n = frame.x.size();
+
+    m_buffer.clear();
+    m_buffer.resize(kFrameHeaderBytes, 0);
+    if (key)
+    {
+        m_buffer.insert(m_buffer.end(), frame.types.begin(), frame.types.end());
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            put<std::uint16_t>(m_buffer, frame.x[i]);
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            put<std::uint16_t>(m_buffer, frame.y[i]);
+        }
+    }
+    else
+    {
+        std::uint32_t changed = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            changed += frame.types[i] != m_previous.types[i] ? 1 : 0;
+        }
+        putVarint(m_buffer, changed);
+        std::uint32_t last = 0;
+        for (std::size_t i = 0; i < n && changed > 0; ++i)
+        {
+            if (frame.types[i] != m_previous.types[i])
+            {
+                putVarint(m_buffer, static_cast<std::uint32_t>(i) - last);
+                m_buffer.push_back(frame.types[i]);
+                last = static_cast<std::uint32_t>(i);
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            putVarint(m_buffer, zigzag(static_cast<std::int32_t>(frame.x[i]) - m_previous.x[i]));
+            putVarint(m_buffer, zigzag(static_cast<std::int32_t>(frame.y[i]) - m_previous.y[i]));
+        }
+    }
+
+    std::uint8_t *h = m_buffer.data();
+    qToLittleEndian(static_cast<std::uint32_t>(m_buffer.size() - kFrameHeaderBytes), h);
+    h[4] = key ? KeyFrame : DeltaFrame;
+    qToLittleEndian(frame.step, h + 8);
+    std::uint64_t timeBits;
+    std::memcpy(&timeBits, &frame.time, sizeof(timeBits));
+    qToLittleEndian(timeBits, h + 16);
+
+    const auto offset = static_cast<std::uint64_t>(m_file.pos());
+    if (m_file.write(reinterpret_cast<const char *>(m_buffer.data()), static_cast<qint64>(m_buffer.size())) !=
+        static_cast<qint64>(m_buffer.size()))
+    {
+        return false;
+    }
+    m_offsets.push_back(offset);
+    m_steps.push_back(frame.step);
+
+    m_previous.x = frame.x;
+    m_previous.y = frame.y;
+    m_previous.types = frame.types;
+    return true;
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    close();
+}
+
+bool TrajectoryReader::open(const QString &path)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_size = static_cast<std::uint64_t>(m_file.size());
+    m_data = m_size > 0 ? m_file.map(0, static_cast<qint64>(m_size)) : nullptr;
+    if (m_data == nullptr || m_size < kHeaderBytes || std::memcmp(m_data, kFileMagic, sizeof(kFileMagic)) != 0 ||
+        get<std::uint32_t>(m_data + 4) < 1 || get<std::uint32_t>(m_data + 4) > trajectory::kVersion)
+    {
+        m_error = m_data == nullptr ? m_file.errorString() : QStringLiteral("не файл траектории");
+        close();
+        return false;
+    }
+
+    m_agentCount = get<std::uint32_t>(m_data + 8);
+    m_keyframeInterval = static_cast<int>(std::max<std::uint32_t>(get<std::uint32_t>(m_data + 12), 1));
+    m_bounds = QRectF(getF64(m_data + 16), getF64(m_data + 24), getF64(m_data + 32), getF64(m_data + 40));
+    m_seed = get<std::uint64_t>(m_data + 48);
+
+    if (!rebuildIndex() || m_offsets.empty())
+    {
+        m_error = QStringLiteral("в файле нет кадров");
+        close();
+        return false;
+    }
+    return seek(0);
+}
+
+void TrajectoryReader::close()
+{
+    if (m_data != nullptr)
+    {
+        m_file.unmap(const_cast<uchar *>(m_data));
+        m_data = nullptr;
+    }
+    m_file.close();
+    m_size = 0;
+    m_offsets.clear();
+    m_steps.clear();
+    m_keys.clear();
+    m_current = -1;
+}
+
+bool TrajectoryReader::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+QString TrajectoryReader::errorString() const
+{
+    return m_error;
+}
+
+bool TrajectoryReader::rebuildIndex()
+{
+    m_offsets.clear();
+    m_steps.clear();
+    m_keys.clear();
+
+    // Таблица из хвоста; если запись оборвалась и хвоста нет, кадры находятся проходом по заголовкам.
+    if (m_size >= kHeaderBytes + kTrailerBytes)
+    {
+        const uchar *trailer = m_data + m_size - kTrailerBytes;
+        const auto frames = get<std::uint64_t>(trailer);
+        const auto indexOffset = get<std::uint64_t>(trailer + 8);
+        if (std::memcmp(trailer + 16, kIndexMagic, sizeof(kIndexMagic)) == 0 && indexOffset >= kHeaderBytes &&
+            indexOffset <= m_size - kTrailerBytes &&
+            frames == (m_size - kTrailerBytes - indexOffset) / kIndexEntryBytes)
+        {
+            m_offsets.reserve(frames);
+            m_steps.reserve(frames);
+            m_keys.reserve(frames);
+            for (std::uint64_t i = 0; i < frames; ++i)
+            {
+                const uchar *entry = m_data + indexOffset + i * kIndexEntryBytes;
+                const auto offset = get<std::uint64_t>(entry);
+                if (offset + kFrameHeaderBytes > indexOffset)
+                {
+                    return false;
+                }
+                m_offsets.push_back(offset);
+                m_steps.push_back(get<std::uint64_t>(entry + 8));
+                m_keys.push_back(m_data[offset + 4] == KeyFrame ? 1 : 0);
+            }
+            return true;
+        }
+    }
+
+    // Проход останавливается на первом кадре, не похожем на продолжение записи (оборванный кадр или
+    // остатки таблицы).
+    const std::uint64_t n = m_agentCount;
+    std::uint64_t offset = kHeaderBytes;
+    while (offset + kFrameHeaderBytes <= m_size)
+    {
+        const uchar *h = m_data + offset;
+        const std::uint32_t payload = get<std::uint32_t>(h);
+        const std::uint64_t step = get<std::uint64_t>(h + 8);
+        const bool periodic = m_offsets.size() % static_cast<std::size_t>(m_keyframeInterval) == 0;
+        const bool key = h[4] == KeyFrame;
+        const std::uint64_t end = offset + kFrameHeaderBytes + payload;
+        if (end > m_size || (h[4] != KeyFrame && h[4] != DeltaFrame) || (periodic && !key) ||
+            (key ? payload != 5 * n : payload < 2 * n + 1) || (!m_steps.empty() && step <= m_steps.back()))
+        {
+            break;
+        }
+        m_offsets.push_back(offset);
+        m_steps.push_back(step);
+        m_keys.push_back(key ? 1 : 0);
+        offset = end;
+    }
+    return true;
+}
+
+int TrajectoryReader::frameCount() const
+{
+    return static_cast<int>(m_offsets.size());
+}
+
+int TrajectoryReader::agentCount() const
+{
+    return static_cast<int>(m_agentCount);
+}
+
+int TrajectoryReader::keyframeInterval() const
+{
+    return m_keyframeInterval;
+}
+
+QRectF TrajectoryReader::bounds() const
+{
+    return m_bounds;
+}
+
+std::uint64_t TrajectoryReader::seed() const
+{
+    return m_seed;
+}
+
+std::uint64_t TrajectoryReader::frameStep(int frame) const
+{
+    return m_steps[static_cast<std::size_t>(frame)];
+}
+
+bool TrajectoryReader::seek(int frame)
+{
+    if (frame < 0 || frame >= frameCount())
+    {
+        return false;
+    }
+    if (frame == m_current)
+    {
+        return true;
+    }
+
+    int key = frame;
+    while (m_keys[static_cast<std::size_t>(key)] == 0 && key % m_keyframeInterval != 0)
+    {
+        --key;
+    }
+    const int start = (m_current >= key && m_current < frame) ? m_current + 1 : key;
+    for (int f = start; f <= frame; ++f)
+    {
+        if (!decodeFrame(f))
+        {
+            m_error = QStringLiteral("повреждён кадр %1").arg(f);
+            m_current = -1;
+            return false;
+        }
+    }
+    m_current = frame;
+    return true;
+}
+
+bool TrajectoryReader::decodeFrame(int frame)
+{
+    const std::uint64_t offset = m_offsets[static_cast<std::size_t>(frame)];
+    const uchar *h = m_data + offset;
+    const std::uint32_t payload = get<std::uint32_t>(h);
+    if (offset + kFrameHeaderBytes + payload > m_size)
+    {
+        return false;
+    }
+    const bool key = h[4] == KeyFrame;
+    if (key != (m_keys[static_cast<std::size_t>(frame)] != 0) || (!key && frame % m_keyframeInterval == 0))
+    {
+        return false;
+    }
+    m_time = getF64(h + 16);
+
+    const std::size_t n = m_agentCount;
+    const uchar *p = h + kFrameHeaderBytes;
+    const uchar *end = p + payload;
+    if (key)
+    {
+        if (payload != n * 5)
+        {
+            return false;
+        }
+        m_types.assign(p, p + n);
+        m_x.resize(n);
+        m_y.resize(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            m_x[i] = get<std::uint16_t>(p + n + 2 * i);
+            m_y[i] = get<std::uint16_t>(p + 3 * n + 2 * i);
+        }
+        return true;
+    }
+
+    std::uint32_t changed = 0;
+    if (!getVarint(p, end, changed))
+    {
+        return false;
+    }
+    std::uint32_t id = 0;
+    for (std::uint32_t k = 0; k < changed; ++k)
+    {
+        std::uint32_t gap = 0;
+        if (!getVarint(p, end, gap) || p >= end)
+        {
+            return false;
+        }
+        id += gap;
+        if (id >= n)
+        {
+            return false;
+        }
+        m_types[id] = *p++;
+    }
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        std::uint32_t dx = 0;
+        std::uint32_t dy = 0;
+        if (!getVarint(p, end, dx) || !getVarint(p, end, dy))
+        {
+            return false;
+        }
+        m_x[i] = static_cast<std::uint16_t>(m_x[i] + unzigzag(dx));
+        m_y[i] = static_cast<std::uint16_t>(m_y[i] + unzigzag(dy));
+    }
+    return true;
+}
+
+int TrajectoryReader::currentFrame() const
+{
+    return m_current;
+}
+
+double TrajectoryReader::time() const
+{
+    return m_time;
+}
+
+int TrajectoryReader::count(ObjType type) const
+{
+    const auto code = static_cast<std::uint8_t>(type);
+    return static_cast<int>(std::count(m_types.begin(), m_types.end(), code));
+}
+
+void TrajectoryReader::positions(ObjType type, std::vector<double> &x, std::vector<double> &y) const
+{
+    const auto code = static_cast<std::uint8_t>(type);
+    const double kx = m_bounds.width() / kQuantMax;
+    const double ky = m_bounds.height() / kQuantMax;
+
+    x.resize(count(type));
+    y.resize(x.size());
+    int k = 0;
+    for (std::size_t i = 0; i < m_types.size(); ++i)
+    {
+        if (m_types[i] == code)
+        {
+            x[k] = m_bounds.left() + m_x[i] * kx;
+            y[k] = m_bounds.top() + m_y[i] * ky;
+            ++k;
+        }
+    }
+}
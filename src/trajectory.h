@@ -0,0 +1,156 @@
+#pragma once
+
+#include <QFile>
+#include <QRectF>
+#include <QString>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "worldobject.h"
+
+class World;
+
+// Формат файла траектории (little-endian):
+//   заголовок 64 байта: "ZTRJ", версия, число агентов, период ключевых кадров, границы мира, seed;
+//   кадры: размер полезной нагрузки, вид (ключевой/дельта), номер шага, время, нагрузка;
+//   таблица кадров (смещение и шаг каждого кадра) и хвост "ZIDX" со ссылкой на неё.
+// Координаты квантуются в 16 бит по границам мира, агенты идут в порядке id. Ключевой кадр хранит
+// типы и координаты целиком, дельта — сменившие тип агенты и zigzag-varint приращения координат.
+// Кадр с номером, кратным периоду, всегда ключевой; ключевым пишется и первый кадр после пропущенных
+// (версия 2, файлы версии 1 читаются так же).
+namespace trajectory
+{
+constexpr std::uint32_t kVersion = 2;
+constexpr int kDefaultKeyframeInterval = 64;
+// Кадров в очереди к потоку записи; сверх этого capture() пропускает кадр.
+constexpr int kMaxQueuedFrames = 8;
+}
+
+// Пишет кадры мира в файл. capture() вызывается в потоке шага: он только квантует позиции в заранее
+// выделенный кадр и кладёт его в очередь; кодирование и запись идут в отдельном потоке. Очередь
+// ограничена kMaxQueuedFrames: если диск не успевает, кадр пропускается (шаг не ждёт, память не растёт),
+// а следующий записанный кадр становится ключевым. Номер шага каждого кадра лежит в файле, так что
+// пропуски видны при просмотре.
+// После первой ошибки записи кадры больше не пишутся, capture() и close() возвращают false, а таблица
+// кадров не дописывается — файл читается как оборванная запись.
+class TrajectoryRecorder
+{
+public:
+    TrajectoryRecorder();
+    ~TrajectoryRecorder();
+
+    TrajectoryRecorder(const TrajectoryRecorder &) = delete;
+    TrajectoryRecorder &operator=(const TrajectoryRecorder &) = delete;
+
+    bool open(const QString &path, const World &world, int keyframeInterval = trajectory::kDefaultKeyframeInterval);
+    bool isOpen() const;
+    QString errorString() const;
+
+    // false — запись не открыта или поток записи уже получил ошибку (см. errorString()).
+    // Пропуск кадра из-за полной очереди ошибкой не считается.
+    bool capture(const World &world);
+    // Кадры, пропущенные с открытия записи из-за полной очереди.
+    std::uint64_t skippedFrames() const;
+    // Дописывает очередь, таблицу кадров и закрывает файл; false, если что-то не записалось.
+    bool close();
+
+private:
+    struct Frame
+    {
+        std::uint64_t step{0};
+        double time{0.0};
+        // Писать ключевым вне периода: перед кадром были пропуски.
+        bool key{false};
+        std::vector<std::uint16_t> x;
+        std::vector<std::uint16_t> y;
+        std::vector<std::uint8_t> types;
+    };
+
+    void writerLoop();
+    bool writeFrame(const Frame &frame);
+    void fail(const QString &error);
+
+    QFile m_file;
+    QString m_error;
+    bool m_open{false};
+
+    // Сторона шага.
+    std::uint32_t m_agentCount{0};
+    QRectF m_bounds;
+    double m_scaleX{0.0};
+    double m_scaleY{0.0};
+
+    // Очередь к потоку записи; отработавшие кадры возвращаются в m_spare.
+    std::thread m_writer;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::unique_ptr<Frame>> m_queue;
+    std::vector<std::unique_ptr<Frame>> m_spare;
+    bool m_stop{false};
+    bool m_failed{false};
+    bool m_forceKey{false};
+    std::uint64_t m_skipped{0};
+
+    // Сторона записи.
+    int m_keyframeInterval{trajectory::kDefaultKeyframeInterval};
+    Frame m_previous;
+    std::vector<std::uint8_t> m_buffer;
+    std::vector<std::uint64_t> m_offsets;
+    std::vector<std::uint64_t> m_steps;
+};
+
+// Читает файл траектории через отображение в память. Переход к кадру декодирует ближайший ключевой
+// кадр не позже нужного (не дальше периода назад) и дельты до него; шаг вперёд с текущего кадра — одна дельта.
+class TrajectoryReader
+{
+public:
+    ~TrajectoryReader();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    int frameCount() const;
+    int agentCount() const;
+    int keyframeInterval() const;
+    QRectF bounds() const;
+    std::uint64_t seed() const;
+    std::uint64_t frameStep(int frame) const;
+
+    bool seek(int frame);
+    int currentFrame() const;
+    double time() const;
+
+    int count(ObjType type) const;
+    // Координаты агентов типа type в порядке id.
+    void positions(ObjType type, std::vector<double> &x, std::vector<double> &y) const;
+
+private:
+    bool rebuildIndex();
+    bool decodeFrame(int frame);
+
+    QFile m_file;
+    QString m_error;
+    const uchar *m_data{nullptr};
+    std::uint64_t m_size{0};
+
+    std::uint32_t m_agentCount{0};
+    int m_keyframeInterval{trajectory::kDefaultKeyframeInterval};
+    QRectF m_bounds;
+    std::uint64_t m_seed{0};
+    std::vector<std::uint64_t> m_offsets;
+    std::vector<std::uint64_t> m_steps;
+    std::vector<std::uint8_t> m_keys;
+
+    int m_current{-1};
+    double m_time{0.0};
+    std::vector<std::uint16_t> m_x;
+    std::vector<std::uint16_t> m_y;
+    std::vector<std::uint8_t> m_types;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+// Тройной буфер без блокировок для одного писателя и одного читателя. Писатель заполняет свой слот
+// и публикует его обменом со средним, читатель забирает средний слот, только если там свежие данные.
+// Ни одна сторона не ждёт другую, читатель всегда видит последний целиком записанный снимок.
+template <typename T>
+class TripleBuffer
+{
+public:
+    T &writeBuffer() { return m_slots[m_back]; }
+
+    void publish()
+    {
+        const unsigned prev = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel);
+        m_back = prev & kIndexMask;
+    }
+
+    // true, если с прошлого вызова появился новый снимок.
+    bool update()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & kFresh) == 0)
+        {
+            return false;
+        }
+        const unsigned prev = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = prev & kIndexMask;
+        return true;
+    }
+
+    const T &readBuffer() const { return m_slots[m_front]; }
+
+private:
+    static constexpr unsigned kIndexMask = 0x3;
+    static constexpr unsigned kFresh = 0x4;
+
+    std::array<T, 3> m_slots{};
+    std::atomic<unsigned> m_middle{1};
+    unsigned m_back{0};
+    unsigned m_front{2};
+};
@@ -1,14 +1,62 @@
 #include "world.h"
 
-#include "human.h"
-#include "zombie.h"
+#include "counterrng.h"
+
+#include <QFile>
+#include <QMetaMethod>
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 #include <limits>
+#include <random>
+#include <type_traits>
 
 namespace
 {
+// Заголовок образа состояния. Все поля фиксированной ширины и без дыр, порядок байт — машинный
+// (проверяется по kStateByteOrder при загрузке).
+struct StateHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t queryMode;
+    std::uint32_t pursuitMode;
+    // Текущий K перестановки по кривой Мортона; 0 — перестановка выключена.
+    std::uint32_t reorderInterval;
+    std::uint64_t agentCount;
+    std::uint64_t nextId;
+    std::uint64_t seed;
+    std::uint64_t stepIndex;
+    std::uint64_t pendingBites;
+    std::uint64_t scheduled;
+    std::uint64_t nextReorder;
+    std::uint64_t typeBegin[kObjTypeCount + 1];
+    double time;
+    double bounds[4];
+    double defaultBiteRadius;
+    double gridCellSize;
+    double flowCellSize;
+    double incubationTime;
+    double perceptionRadius;
+};
+static_assert(std::is_trivially_copyable<StateHeader>::value, "StateHeader must be a flat record");
+
+// Запланированное превращение заражённого: срок (номер шага) и id агента.
+struct ScheduledRecord
+{
+    std::uint64_t due;
+    std::uint32_t id;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(ScheduledRecord) == 16, "ScheduledRecord must be packed");
+
+constexpr char kStateMagic[4] = {'Z', 'W', 'S', 'T'};
+constexpr std::uint32_t kStateVersion = 5;
+constexpr std::uint32_t kStateByteOrder = 0x01020304;
+
 double length(const QPointF &p)
 {
     return std::hypot(p.x(), p.y());
@@ -23,17 +71,56 @@ QPointF normalized(const QPointF &p)
     }
     return QPointF(p.x() / len, p.y() / len);
 }
+
+// Обновляет агентов типа поведения в пересечении куска [begin, end) с диапазоном этого типа.
+template <typename Behavior>
+void updateTypeSlice(Behavior &behavior, StepContext &ctx, const AgentStore &agents, std::size_t begin,
+                     std::size_t end)
+{
+    const ObjType type = behavior.type();
+    const auto lo = static_cast<AgentIndex>(std::max<std::size_t>(begin, agents.typeBegin(type)));
+    const auto hi = static_cast<AgentIndex>(std::min<std::size_t>(end, agents.typeEnd(type)));
+    if (lo < hi)
+    {
+        behavior.updateRange(ctx, lo, hi);
+    }
+}
 }
 
-World::World(QObject *parent) : QObject(parent)
+namespace
 {
-    std::random_device rd;
-    m_rng.seed(rd());
+constexpr std::size_t kStepGrain = 1024;
+constexpr std::uint64_t kSpawnStep = std::numeric_limits<std::uint64_t>::max();
+// Отдельный поток выборок для длительности инкубации, чтобы она не коррелировала с движением на том же шаге.
+constexpr std::uint64_t kIncubationStream = 0x6A09E667F3BCC909ULL;
+
+// Перестановка по кривой Мортона: меньшие миры целиком помещаются в кэш и не переставляются.
+constexpr std::size_t kReorderMinAgents = 4096;
+constexpr double kReorderAgentsPerCell = 16.0;
+constexpr int kReorderInitialInterval = 16;
+constexpr int kReorderMinInterval = 4;
+constexpr int kReorderMaxInterval = 1024;
+// Доля разрывов (соседние строки, не бывшие соседями до сортировки): ниже нижнего порога порядок
+// почти не испортился и K удваивается, выше верхнего — K уменьшается вдвое.
+constexpr double kReorderDriftLow = 0.02;
+constexpr double kReorderDriftHigh = 0.1;
+
+using Clock = std::chrono::steady_clock;
+
+std::int64_t nsBetween(Clock::time_point from, Clock::time_point to)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
 }
 
+World::World(QObject *parent) : QObject(parent), m_workers(1) {}
+
+World::~World() = default;
+
 void World::setBounds(const QRectF &rect)
 {
     m_bounds = rect;
+    m_indexDirty = true;
 }
 
 QRectF World::bounds() const
@@ -51,177 +138,832 @@ double World::defaultBiteRadius() const
     return m_defaultBiteRadius;
 }
 
+void World::setIncubationTime(double mean)
+{
+    m_incubationTime = std::max(mean, 0.0);
+}
+
+double World::incubationTime() const
+{
+    return m_incubationTime;
+}
+
+void World::setPerceptionRadius(double radius)
+{
+    m_perceptionRadius = std::max(radius, 0.0);
+}
+
+double World::perceptionRadius() const
+{
+    return m_perceptionRadius;
+}
+
+void World::applyBiteRadius(double radius)
+{
+    m_defaultBiteRadius = radius;
+    for (AgentIndex i = m_agents.typeBegin(ObjType::Zombie); i < m_agents.typeEnd(ObjType::Zombie); ++i)
+    {
+        m_agents.setBiteRadius(i, radius);
+    }
+}
+
+void World::setQueryMode(World::QueryMode mode)
+{
+    m_queryMode = mode;
+    m_indexDirty = true;
+}
+
+World::QueryMode World::queryMode() const
+{
+    return m_queryMode;
+}
+
+void World::setPursuitMode(World::PursuitMode mode)
+{
+    m_pursuitMode = mode;
+    m_indexDirty = true;
+}
+
+World::PursuitMode World::pursuitMode() const
+{
+    return m_pursuitMode;
+}
+
+void World::setSpatialReorder(bool enabled)
+{
+    m_reorderEnabled = enabled;
+}
+
+bool World::spatialReorder() const
+{
+    return m_reorderEnabled;
+}
+
+int World::reorderInterval() const
+{
+    return m_reorderInterval;
+}
+
+void World::setFlowCellSize(double size)
+{
+    m_flowField.setCellSize(size);
+    m_indexDirty = true;
+}
+
+double World::flowCellSize() const
+{
+    return m_flowField.cellSize();
+}
+
+QByteArray World::stateImage() const
+{
+    const std::size_t count = m_agents.size();
+    const std::vector<AgentIndex> &pending = m_bites.victims();
+
+    StateHeader header{};
+    std::memcpy(header.magic, kStateMagic, sizeof(kStateMagic));
+    header.version = kStateVersion;
+    header.byteOrder = kStateByteOrder;
+    header.queryMode = static_cast<std::uint32_t>(m_queryMode);
+    header.pursuitMode = static_cast<std::uint32_t>(m_pursuitMode);
+    header.agentCount = count;
+    header.nextId = m_agents.nextId();
+    header.seed = m_seed;
+    header.stepIndex = m_stepIndex;
+    header.pendingBites = pending.size();
+    header.scheduled = m_incubation.size();
+    header.reorderInterval = m_reorderEnabled ? static_cast<std::uint32_t>(m_reorderInterval) : 0;
+    header.nextReorder = m_nextReorder;
+    for (std::size_t t = 0; t <= kObjTypeCount; ++t)
+    {
+        header.typeBegin[t] = m_agents.typeBegins()[t];
+    }
+    header.time = m_time;
+    header.bounds[0] = m_bounds.left();
+    header.bounds[1] = m_bounds.top();
+    header.bounds[2] = m_bounds.width();
+    header.bounds[3] = m_bounds.height();
+    header.defaultBiteRadius = m_defaultBiteRadius;
+    header.gridCellSize = gridCellSize();
+    header.flowCellSize = flowCellSize();
+    header.incubationTime = m_incubationTime;
+    header.perceptionRadius = m_perceptionRadius;
+
+    const std::size_t agentBytes = AgentStore::imageBytes(count);
+    const std::size_t pendingBytes = pending.size() * sizeof(AgentIndex);
+    const std::size_t scheduledBytes = m_incubation.size() * sizeof(ScheduledRecord);
+    QByteArray image(static_cast<int>(sizeof(header) + agentBytes + pendingBytes + scheduledBytes),
+                     Qt::Uninitialized);
+    auto *out = reinterpret_cast<unsigned char *>(image.data());
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    m_agents.writeImage(out);
+    out += agentBytes;
+    if (pendingBytes > 0)
+    {
+        std::memcpy(out, pending.data(), pendingBytes);
+        out += pendingBytes;
+    }
+    // Порядок записей в колесе зависит от того, в каком порядке потоки отдали укусы, поэтому записи
+    // сортируются по (срок, id): один и тот же мир даёт один и тот же образ при любом числе потоков.
+    std::vector<ScheduledRecord> records;
+    records.reserve(m_incubation.size());
+    m_incubation.forEach([&records](std::uint32_t id, std::uint64_t due) { records.push_back({due, id, 0}); });
+    std::sort(records.begin(), records.end(), [](const ScheduledRecord &a, const ScheduledRecord &b) {
+        return a.due != b.due ? a.due < b.due : a.id < b.id;
+    });
+    if (scheduledBytes > 0)
+    {
+        std::memcpy(out, records.data(), scheduledBytes);
+    }
+    return image;
+}
+
+bool World::restoreState(const QByteArray &image)
+{
+    StateHeader header{};
+    const auto size = static_cast<std::size_t>(image.size());
+    if (size < sizeof(header))
+    {
+        reset(0, 0, m_seed);
+        return false;
+    }
+    std::memcpy(&header, image.constData(), sizeof(header));
+
+    const bool valid = std::memcmp(header.magic, kStateMagic, sizeof(kStateMagic)) == 0 &&
+                       header.version == kStateVersion && header.byteOrder == kStateByteOrder &&
+                       header.agentCount <= std::numeric_limits<AgentIndex>::max() &&
+                       header.nextId <= std::numeric_limits<AgentId>::max() &&
+                       header.pendingBites <= header.agentCount && header.scheduled <= header.agentCount &&
+                       size == sizeof(header) + AgentStore::imageBytes(header.agentCount) +
+                                   header.pendingBites * sizeof(AgentIndex) +
+                                   header.scheduled * sizeof(ScheduledRecord);
+    std::array<AgentIndex, kObjTypeCount + 1> typeBegin{};
+    for (std::size_t t = 0; t <= kObjTypeCount; ++t)
+    {
+        typeBegin[t] = static_cast<AgentIndex>(std::min<std::uint64_t>(header.typeBegin[t], header.agentCount));
+    }
+
+    const auto *in = reinterpret_cast<const unsigned char *>(image.constData()) + sizeof(header);
+    const auto count = static_cast<std::size_t>(header.agentCount);
+    if (!valid || !m_agents.readImage(in, count, typeBegin, static_cast<AgentId>(header.nextId)))
+    {
+        reset(0, 0, m_seed);
+        return false;
+    }
+
+    m_seed = header.seed;
+    m_stepIndex = header.stepIndex;
+    m_time = header.time;
+    m_bounds = QRectF(header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3]);
+    m_defaultBiteRadius = header.defaultBiteRadius;
+    m_queryMode = header.queryMode == static_cast<std::uint32_t>(QueryMode::BruteForce) ? QueryMode::BruteForce
+                                                                                        : QueryMode::Grid;
+    m_pursuitMode = header.pursuitMode == static_cast<std::uint32_t>(PursuitMode::FlowField)
+                        ? PursuitMode::FlowField
+                        : PursuitMode::Nearest;
+    setGridCellSize(header.gridCellSize);
+    setFlowCellSize(header.flowCellSize);
+    m_incubationTime = std::max(header.incubationTime, 0.0);
+    m_perceptionRadius = std::max(header.perceptionRadius, 0.0);
+    const auto interval = static_cast<int>(std::min<std::uint32_t>(header.reorderInterval, kReorderMaxInterval));
+    m_reorderEnabled = interval > 0;
+    m_reorderInterval = m_reorderEnabled ? std::max(interval, kReorderMinInterval) : kReorderInitialInterval;
+    m_nextReorder = header.nextReorder;
+
+    m_bites.resize(count);
+    const unsigned char *pending = in + AgentStore::imageBytes(count);
+    for (std::uint64_t k = 0; k < header.pendingBites; ++k)
+    {
+        AgentIndex victim;
+        std::memcpy(&victim, pending + k * sizeof(AgentIndex), sizeof(victim));
+        if (victim < count)
+        {
+            m_bites.record(victim);
+        }
+    }
+
+    // Сроки, не принадлежащие заражённому человеку, отбрасываются: колесо и статусы остаются согласованы.
+    m_incubation.clear(m_stepIndex);
+    const unsigned char *scheduled = pending + header.pendingBites * sizeof(AgentIndex);
+    for (std::uint64_t k = 0; k < header.scheduled; ++k)
+    {
+        ScheduledRecord record;
+        std::memcpy(&record, scheduled + k * sizeof(ScheduledRecord), sizeof(record));
+        if (record.id < count && m_agents.type(m_agents.slotOf(record.id)) == ObjType::Human &&
+            m_agents.status(m_agents.slotOf(record.id)) == ObjStatus::Infected)
+        {
+            m_incubation.schedule(record.id, record.due);
+        }
+    }
+
+    m_counters.clear();
+    for (AgentIndex i = 0; i < count; ++i)
+    {
+        m_counters.add(m_agents.type(i), m_agents.status(i));
+    }
+
+    m_stats.clear();
+    m_profile = StepProfile();
+    m_indexDirty = true;
+    updateMetrics(0);
+
+    emit populationChanged(humanCount(), zombieCount(), infectedCount(), m_time);
+    emit worldUpdated();
+    return true;
+}
+
+bool World::saveState(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+    const QByteArray image = stateImage();
+    return file.write(image) == image.size();
+}
+
+bool World::loadState(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    // Образ читается целиком одним read в заранее выделенный буфер.
+    QByteArray image(static_cast<int>(file.size()), Qt::Uninitialized);
+    if (file.read(image.data(), image.size()) != image.size())
+    {
+        return false;
+    }
+    return restoreState(image);
+}
+
+void World::setGridCellSize(double size)
+{
+    m_humanGrid.setCellSize(size);
+    m_zombieGrid.setCellSize(size);
+    m_indexDirty = true;
+}
+
+double World::gridCellSize() const
+{
+    return m_humanGrid.cellSize();
+}
+
+void World::setThreadCount(int threads)
+{
+    if (threads <= 0)
+    {
+        threads = ThreadPool::hardwareThreads();
+    }
+    if (threads == threadCount())
+    {
+        return;
+    }
+
+    m_pool.reset();
+    if (threads > 1)
+    {
+        m_pool = std::make_unique<ThreadPool>(threads);
+    }
+    m_workers.assign(static_cast<std::size_t>(threads), {});
+}
+
+int World::threadCount() const
+{
+    return m_pool ? m_pool->threadCount() : 1;
+}
+
+ThreadPool *World::threadPool() const
+{
+    return m_pool.get();
+}
+
 void World::reset(int humans, int zombies)
 {
-    m_objects.clear();
-    m_pendingConversions.clear();
+    std::random_device rd;
+    const std::uint64_t seed = (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
+    reset(humans, zombies, seed);
+}
+
+void World::reset(int humans, int zombies, std::uint64_t seed)
+{
+    m_agents.clear();
+    m_bites.clear();
+    m_incubation.clear(0);
+    m_counters.clear();
     m_time = 0.0;
+    m_seed = seed;
+    m_stepIndex = 0;
+    m_reorderInterval = kReorderInitialInterval;
+    m_nextReorder = 1;
+    m_profile = StepProfile();
+    m_stats.clear();
+    m_indexDirty = true;
+
+    m_agents.reserve(static_cast<std::size_t>(std::max(humans, 0) + std::max(zombies, 0)));
 
     spawnHumans(humans);
     spawnZombies(zombies);
+    m_bites.resize(m_agents.size());
+    updateMetrics(0);
 
-    emit populationChanged(humanCount(), zombieCount(), m_time);
+    emit populationChanged(humanCount(), zombieCount(), infectedCount(), m_time);
     emit worldUpdated();
 }
 
+std::uint64_t World::seed() const
+{
+    return m_seed;
+}
+
 void World::spawnHumans(int count)
 {
-    std::uniform_real_distribution<double> distX(m_bounds.left(), m_bounds.right());
-    std::uniform_real_distribution<double> distY(m_bounds.top(), m_bounds.bottom());
-    std::uniform_real_distribution<double> dir(-1.0, 1.0);
+    spawn(ObjType::Human, count, 8.0);
+}
+
+void World::spawnZombies(int count)
+{
+    spawn(ObjType::Zombie, count, 4.0);
+}
+
+void World::spawn(ObjType type, int count, double initialSpeed)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    const auto n = static_cast<std::size_t>(count);
+    std::vector<AgentId> ids(n);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        ids[k] = m_agents.nextId() + static_cast<AgentId>(k);
+    }
+
+    std::vector<double> ux(n);
+    std::vector<double> uy(n);
+    std::vector<double> hx(n);
+    std::vector<double> hy(n);
+    CounterRng::fillUnit(m_seed, kSpawnStep, 1, ids.data(), n, ux.data());
+    CounterRng::fillUnit(m_seed, kSpawnStep, 2, ids.data(), n, uy.data());
+    CounterRng::fillUnit(m_seed, kSpawnStep, 3, ids.data(), n, hx.data());
+    CounterRng::fillUnit(m_seed, kSpawnStep, 4, ids.data(), n, hy.data());
 
-    for (int i = 0; i < count; ++i)
+    WorldObject &behavior = behaviorFor(type);
+    const double biteRadius = (type == ObjType::Zombie) ? m_defaultBiteRadius : 0.0;
+
+    for (std::size_t k = 0; k < n; ++k)
     {
-        auto human = std::make_unique<Human>();
-        ObjState &s = human->mutableState();
-        s.pos = QPointF(distX(m_rng), distY(m_rng));
+        const QPointF pos(m_bounds.left() + ux[k] * m_bounds.width(), m_bounds.top() + uy[k] * m_bounds.height());
 
-        QPointF heading(dir(m_rng), dir(m_rng));
+        QPointF heading(hx[k] * 2.0 - 1.0, hy[k] * 2.0 - 1.0);
         heading = normalized(heading);
-        s.vel = QPointF(heading.x() * 8.0, heading.y() * 8.0);
+        const QPointF vel(heading.x() * initialSpeed, heading.y() * initialSpeed);
 
-        connectObject(human.get());
-        m_objects.push_back(std::move(human));
+        m_agents.add(type, pos, vel, behavior.defaultSpeed(), biteRadius);
     }
+    m_counters.add(type, ObjStatus::Idle, count);
 }
 
-void World::spawnZombies(int count)
+WorldObject &World::behaviorFor(ObjType type)
+{
+    if (type == ObjType::Human)
+    {
+        return m_humanBehavior;
+    }
+    return m_zombieBehavior;
+}
+
+void World::reorderAgents()
 {
-    std::uniform_real_distribution<double> distX(m_bounds.left(), m_bounds.right());
-    std::uniform_real_distribution<double> distY(m_bounds.top(), m_bounds.bottom());
-    std::uniform_real_distribution<double> dir(-1.0, 1.0);
+    const std::size_t count = m_agents.size();
+    const std::vector<double> &xs = m_agents.xs();
+    const std::vector<double> &ys = m_agents.ys();
+    ThreadPool *pool = m_pool.get();
+
+    // Каждый тип сортируется в своём диапазоне, поэтому границы типов не двигаются.
+    m_order.resize(count);
+    std::size_t breaks = 0;
+    for (ObjType type : {ObjType::Human, ObjType::Zombie})
+    {
+        const AgentIndex begin = m_agents.typeBegin(type);
+        const AgentIndex end = m_agents.typeEnd(type);
+        // Разрешение кривой — около kReorderAgentsPerCell агентов типа на ячейку (несколько строк кэша):
+        // перемещения внутри ячейки порядок не портят, и доля разрывов показывает, сколько агентов
+        // сменили ячейку с прошлой сортировки.
+        const double cells = std::max((end - begin) / kReorderAgentsPerCell, 2.0);
+        const int bits = static_cast<int>(std::ceil(0.5 * std::log2(cells)));
+        m_morton.sort(xs.data(), ys.data(), begin, end, m_bounds, bits, pool, m_typeOrder);
+        for (std::size_t k = 0; k < m_typeOrder.size(); ++k)
+        {
+            m_order[begin + k] = begin + m_typeOrder[k];
+            if (k > 0 && m_typeOrder[k] != m_typeOrder[k - 1] + 1)
+            {
+                ++breaks;
+            }
+        }
+    }
+    m_agents.permute(m_order, pool);
+    m_indexDirty = true;
 
-    for (int i = 0; i < count; ++i)
+    const double drift = static_cast<double>(breaks) / static_cast<double>(std::max<std::size_t>(count, 1));
+    if (drift < kReorderDriftLow)
     {
-        auto zombie = std::make_unique<Zombie>();
-        ObjState &s = zombie->mutableState();
-        s.pos = QPointF(distX(m_rng), distY(m_rng));
+        m_reorderInterval = std::min(m_reorderInterval * 2, kReorderMaxInterval);
+    }
+    else if (drift > kReorderDriftHigh)
+    {
+        m_reorderInterval = std::max(m_reorderInterval / 2, kReorderMinInterval);
+    }
+    m_nextReorder = m_stepIndex + static_cast<std::uint64_t>(m_reorderInterval);
+}
 
-        QPointF heading(dir(m_rng), dir(m_rng));
-        heading = normalized(heading);
-        s.vel = QPointF(heading.x() * 4.0, heading.y() * 4.0);
+void World::rebuildIndex() const
+{
+    const std::vector<double> &xs = m_agents.xs();
+    const std::vector<double> &ys = m_agents.ys();
 
-        zombie->setBiteRadius(m_defaultBiteRadius);
+    // Заражённые люди уже не цели: в индекс людей (и в источники поля) попадают только здоровые.
+    m_targets.clear();
+    for (AgentIndex i = m_agents.typeBegin(ObjType::Human); i < m_agents.typeEnd(ObjType::Human); ++i)
+    {
+        if (m_agents.status(i) != ObjStatus::Infected)
+        {
+            m_targets.push_back(i);
+        }
+    }
+    m_humanGrid.beginBuild(m_bounds, m_targets.size());
+    for (AgentIndex i : m_targets)
+    {
+        m_humanGrid.add(xs[i], ys[i], i);
+    }
+    m_humanGrid.finishBuild();
 
-        connectObject(zombie.get());
-        m_objects.push_back(std::move(zombie));
+    const AgentIndex zombiesEnd = m_agents.typeEnd(ObjType::Zombie);
+    m_zombieGrid.beginBuild(m_bounds, zombiesEnd - m_agents.typeBegin(ObjType::Zombie));
+    for (AgentIndex i = m_agents.typeBegin(ObjType::Zombie); i < zombiesEnd; ++i)
+    {
+        m_zombieGrid.add(xs[i], ys[i], i);
     }
+    m_zombieGrid.finishBuild();
+
+    if (m_pursuitMode == PursuitMode::FlowField)
+    {
+        m_flowField.build(m_bounds, xs.data(), ys.data(), m_targets.data(), m_targets.size());
+    }
+    m_indexDirty = false;
 }
 
-void World::connectObject(WorldObject *obj)
+const SpatialGrid &World::gridFor(ObjType type) const
 {
-    if (auto *z = dynamic_cast<Zombie *>(obj))
+    if (m_indexDirty)
+    {
+        rebuildIndex();
+    }
+    return type == ObjType::Human ? m_humanGrid : m_zombieGrid;
+}
+
+World::Pursuit World::pursuit(const QPointF &pos) const
+{
+    if (m_pursuitMode == PursuitMode::Nearest)
+    {
+        const AgentRef target = closestHuman(pos);
+        return {target, target ? target.pos() : pos};
+    }
+    if (m_indexDirty)
+    {
+        rebuildIndex();
+    }
+    const double *xs = m_agents.xs().data();
+    const double *ys = m_agents.ys().data();
+
+    // В ячейке источника и по соседству цель — ближайший из источников окрестности, к нему идут напрямую.
+    if (m_flowField.distance(pos.x(), pos.y()) <= 1)
+    {
+        const std::uint32_t source = m_flowField.nearestSource(pos.x(), pos.y(), xs, ys);
+        if (source == FlowField::kNoSource)
+        {
+            return {AgentRef(), pos};
+        }
+        return {m_agents.at(source), QPointF(xs[source], ys[source])};
+    }
+
+    // Дальше — по полю: к центру ячейки-родителя, цель — источник своей ячейки.
+    const std::uint32_t source = m_flowField.source(pos.x(), pos.y());
+    double wx;
+    double wy;
+    if (source == FlowField::kNoSource || !m_flowField.waypoint(pos.x(), pos.y(), wx, wy))
     {
-        connect(z, &Zombie::biteSignal, this, &World::onBite);
+        return {AgentRef(), pos};
     }
+    return {m_agents.at(source), QPointF(wx, wy)};
 }
 
-WorldObject *World::closestHuman(const QPointF &pos) const
+AgentRef World::closestHuman(const QPointF &pos) const
 {
-    WorldObject *closest = nullptr;
+    if (m_queryMode == QueryMode::Grid)
+    {
+        const std::uint32_t id = gridFor(ObjType::Human).nearest(pos.x(), pos.y());
+        return id == SpatialGrid::kNoEntry ? AgentRef() : m_agents.at(id);
+    }
+
+    const std::vector<double> &xs = m_agents.xs();
+    const std::vector<double> &ys = m_agents.ys();
+    const std::vector<ObjType> &types = m_agents.types();
+
+    AgentIndex closest = kNoAgent;
     double bestDist = std::numeric_limits<double>::max();
 
-    for (const auto &obj : m_objects)
+    for (std::size_t i = 0; i < types.size(); ++i)
     {
-        if (obj->type() != ObjType::Human)
+        if (types[i] != ObjType::Human || m_agents.status(static_cast<AgentIndex>(i)) == ObjStatus::Infected)
         {
             continue;
         }
-        const double d = length(obj->state().pos - pos);
+        const double d = std::hypot(xs[i] - pos.x(), ys[i] - pos.y());
         if (d < bestDist)
         {
             bestDist = d;
-            closest = obj.get();
+            closest = static_cast<AgentIndex>(i);
         }
     }
 
-    return closest;
+    return closest == kNoAgent ? AgentRef() : m_agents.at(closest);
 }
 
-std::vector<WorldObject *> World::objectsInRadius(const QPointF &pos, double radius, ObjType type) const
+std::vector<AgentRef> World::objectsInRadius(const QPointF &pos, double radius, ObjType type) const
 {
-    std::vector<WorldObject *> result;
-    for (const auto &obj : m_objects)
+    std::vector<AgentIndex> indices;
+    objectsInRadius(pos, radius, type, indices);
+
+    std::vector<AgentRef> result;
+    result.reserve(indices.size());
+    for (AgentIndex index : indices)
     {
-        if (obj->type() != type)
-        {
-            continue;
-        }
-        if (length(obj->state().pos - pos) <= radius)
+        result.push_back(m_agents.at(index));
+    }
+    return result;
+}
+
+void World::objectsInRadius(const QPointF &pos, double radius, ObjType type, std::vector<AgentIndex> &out) const
+{
+    out.clear();
+    forEachInRadius(pos, radius, type, [&out](AgentIndex index) { out.push_back(index); });
+    std::sort(out.begin(), out.end());
+}
+
+void World::objectsInRadius(const QPointF *points, std::size_t count, double radius, ObjType type,
+                            NeighborBatch &out) const
+{
+    out.reset(count);
+    std::vector<AgentIndex> &indices = out.m_indices;
+
+    if (m_queryMode == QueryMode::Grid)
+    {
+        // Точки одного запроса приходят подряд, поэтому его кусок открывается на первой из них.
+        std::size_t current = count;
+        gridFor(type).forEachInRadiusBatch(points, count, radius, out.m_scratch,
+                                           [&](std::size_t q, std::uint32_t index, double, double) {
+                                               if (q != current)
+                                               {
+                                                   current = q;
+                                                   out.m_first[q] = static_cast<std::uint32_t>(indices.size());
+                                               }
+                                               indices.push_back(index);
+                                               ++out.m_count[q];
+                                           });
+    }
+    else
+    {
+        for (std::size_t q = 0; q < count; ++q)
         {
-            result.push_back(obj.get());
+            out.m_first[q] = static_cast<std::uint32_t>(indices.size());
+            forEachInRadius(points[q], radius, type, [&indices](AgentIndex index) { indices.push_back(index); });
+            out.m_count[q] = static_cast<std::uint32_t>(indices.size() - out.m_first[q]);
         }
     }
-    return result;
+
+    for (std::size_t q = 0; q < count; ++q)
+    {
+        AgentIndex *first = indices.data() + out.m_first[q];
+        std::sort(first, first + out.m_count[q]);
+    }
 }
 
-void World::onBite(WorldObject *victim)
+void World::closestHumans(const QPointF *points, std::size_t count, NeighborBatch &out) const
 {
-    if (victim == nullptr || victim->type() != ObjType::Human)
+    out.reset(count);
+    std::vector<AgentIndex> &indices = out.m_indices;
+
+    const auto answer = [&](std::size_t q, AgentIndex index) {
+        out.m_first[q] = static_cast<std::uint32_t>(indices.size());
+        if (index != kNoAgent)
+        {
+            indices.push_back(index);
+            out.m_count[q] = 1;
+        }
+    };
+
+    const SpatialGrid *grid = m_queryMode == QueryMode::Grid ? &gridFor(ObjType::Human) : nullptr;
+    if (grid)
     {
+        // Запросы одной ячейки делят обход колец сетки: каждое кольцо собирается один раз на ячейку.
+        grid->nearestBatch(points, count, out.m_scratch, [&](std::size_t q, std::uint32_t index) {
+            answer(q, index == SpatialGrid::kNoEntry ? kNoAgent : index);
+        });
         return;
     }
-    const bool alreadyQueued = std::any_of(m_pendingConversions.begin(), m_pendingConversions.end(),
-                                           [&](WorldObject *ptr) { return ptr == victim; });
-    if (!alreadyQueued)
+
+    for (std::size_t q = 0; q < count; ++q)
     {
-        m_pendingConversions.push_back(victim);
+        answer(q, closestHuman(points[q]).index());
     }
 }
 
-void World::processPendingConversions()
+void World::mergeWorkerResults()
 {
-    for (WorldObject *victim : m_pendingConversions)
+    for (WorkerScratch &worker : m_workers)
     {
-        auto it = std::find_if(m_objects.begin(), m_objects.end(),
-                               [&](const std::unique_ptr<WorldObject> &ptr) { return ptr.get() == victim; });
-        if (it == m_objects.end() || (*it)->type() != ObjType::Human)
+        for (AgentIndex victim : worker.bites)
+        {
+            if (m_agents.type(victim) == ObjType::Human)
+            {
+                m_bites.record(victim);
+            }
+        }
+        worker.bites.clear();
+
+        m_counters += worker.counters;
+        worker.counters.clear();
+
+        m_stats += worker.stats;
+        worker.stats.clear();
+    }
+}
+
+void World::convertToZombie(AgentIndex victim)
+{
+    m_counters.move(ObjType::Human, m_agents.status(victim), ObjType::Zombie, ObjStatus::Idle);
+
+    const AgentIndex slot = m_agents.changeType(victim, ObjType::Zombie);
+    m_agents.setStatus(slot, ObjStatus::Idle);
+    m_agents.setBusy(slot, false);
+    m_agents.setSpeed(slot, m_zombieBehavior.defaultSpeed());
+    m_agents.setBiteRadius(slot, m_defaultBiteRadius);
+}
+
+int World::processPendingConversions(double dt, int &bitten)
+{
+    m_converting.clear();
+    bitten = 0;
+
+    // Укушенный человек либо заражается и встаёт в колесо сроков, либо (без инкубации) превращается сразу.
+    // Повторный укус заражённого ничего не меняет.
+    for (AgentIndex victim : m_bites.victims())
+    {
+        if (m_agents.type(victim) != ObjType::Human || m_agents.status(victim) == ObjStatus::Infected)
         {
             continue;
         }
+        ++bitten;
+        if (m_incubationTime <= 0.0)
+        {
+            m_converting.push_back(victim);
+            continue;
+        }
+
+        const AgentId id = m_agents.id(victim);
+        CounterRng rng(m_seed ^ kIncubationStream, id, m_stepIndex);
+        const double u1 = 1.0 - rng.nextDouble();
+        const double u2 = 1.0 - rng.nextDouble();
+        const double incubation = -0.5 * m_incubationTime * (std::log(u1) + std::log(u2));
+        const double steps = dt > 0.0 ? std::ceil(incubation / dt) : 1.0;
+        const auto delay = static_cast<std::uint64_t>(std::clamp(steps, 1.0, 1e15));
+
+        m_counters.move(ObjType::Human, m_agents.status(victim), ObjType::Human, ObjStatus::Infected);
+        m_agents.setStatus(victim, ObjStatus::Infected);
+        m_incubation.schedule(id, m_stepIndex + delay);
+    }
+    m_bites.clear();
+
+    // Колесо отдаёт только тех, чей срок наступил на этом шаге.
+    m_due.clear();
+    m_incubation.advance(m_stepIndex, m_due);
+    for (std::uint32_t id : m_due)
+    {
+        const AgentIndex slot = m_agents.slotOf(id);
+        if (m_agents.type(slot) == ObjType::Human && m_agents.status(slot) == ObjStatus::Infected)
+        {
+            m_converting.push_back(slot);
+        }
+    }
 
-        const ObjState saved = (*it)->state();
-        m_objects.erase(it);
+    // Обмен с последним человеком сдвигает только строки с большими индексами,
+    // поэтому жертвы обрабатываются по убыванию слота.
+    std::sort(m_converting.begin(), m_converting.end(), std::greater<AgentIndex>());
+    for (AgentIndex victim : m_converting)
+    {
+        convertToZombie(victim);
+    }
 
-        auto zombie = std::make_unique<Zombie>();
-        zombie->mutableState().pos = saved.pos;
-        zombie->mutableState().vel = saved.vel;
-        zombie->setBiteRadius(m_defaultBiteRadius);
-        connectObject(zombie.get());
-        m_objects.push_back(std::move(zombie));
+    if (!m_converting.empty())
+    {
+        m_indexDirty = true;
+    }
+    return static_cast<int>(m_converting.size());
+}
+
+void World::updateRange(std::size_t begin, std::size_t end, int worker, double dt)
+{
+    WorkerScratch &scratch = m_workers[static_cast<std::size_t>(worker)];
+    StepContext ctx{*this, m_agents, scratch.bites, scratch.counters, scratch.stats, dt, m_seed, m_stepIndex};
+    // Кусок может захватить несколько диапазонов типов: каждый тип обновляется своим невиртуальным
+    // циклом по пересечению куска со своим диапазоном. Новый тип агентов — ещё одна строка здесь.
+    updateTypeSlice(m_humanBehavior, ctx, m_agents, begin, end);
+    updateTypeSlice(m_zombieBehavior, ctx, m_agents, begin, end);
+
+    const double *vx = m_agents.vxs().data();
+    const double *vy = m_agents.vys().data();
+    double speedSum = 0.0;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        speedSum += std::sqrt(vx[i] * vx[i] + vy[i] * vy[i]);
     }
+    scratch.stats.speedSum += speedSum;
 
-    m_pendingConversions.clear();
+    m_agents.integrate(dt, m_bounds, begin, end);
 }
 
 void World::step(double dt)
 {
+    const Clock::time_point start = Clock::now();
     m_time += dt;
+    ++m_stepIndex;
 
-    for (auto &obj : m_objects)
+    if (m_reorderEnabled && m_stepIndex >= m_nextReorder && m_agents.size() >= kReorderMinAgents)
     {
-        obj->updateState(*this, dt);
+        reorderAgents();
     }
+    const Clock::time_point reordered = Clock::now();
 
-    for (auto &obj : m_objects)
+    // Индекс и поле строятся до прохода: во время него агенты только читают позиции начала шага.
+    if ((m_queryMode == QueryMode::Grid || m_pursuitMode == PursuitMode::FlowField) && m_indexDirty)
     {
-        obj->integrate(dt, m_bounds);
+        rebuildIndex();
     }
+    const Clock::time_point indexed = Clock::now();
 
-    processPendingConversions();
-
-    for (auto &obj : m_objects)
+    const std::size_t count = m_agents.size();
+    if (m_pool)
+    {
+        m_pool->parallelFor(count, kStepGrain, [this, dt](std::size_t begin, std::size_t end, int worker) {
+            updateRange(begin, end, worker, dt);
+        });
+    }
+    else
     {
-        obj->setBusy(false);
+        updateRange(0, count, 0, dt);
     }
 
-    emit populationChanged(humanCount(), zombieCount(), m_time);
-    emit worldUpdated();
+    m_agents.commitPositions();
+    m_indexDirty = true;
+    const Clock::time_point updated = Clock::now();
+
+    mergeWorkerResults();
+    int bitten = 0;
+    const int converted = processPendingConversions(dt, bitten);
+
+    m_agents.clearBusy();
+    const Clock::time_point finished = Clock::now();
+
+    m_profile.reorderNs = nsBetween(start, reordered);
+    m_profile.indexNs = nsBetween(reordered, indexed);
+    m_profile.updateNs = nsBetween(indexed, updated);
+    m_profile.conversionNs = nsBetween(updated, finished);
+    m_profile.totalNs = nsBetween(start, finished);
+    m_profile.conversions = converted;
+    updateMetrics(bitten);
+
+    // Шаг крутится в потоке воркера тысячи раз в секунду, а GUI читает снимки и сводки, поэтому
+    // сигналы шага отправляются только при подключённых получателях.
+    static const QMetaMethod populationSignal = QMetaMethod::fromSignal(&World::populationChanged);
+    static const QMetaMethod updatedSignal = QMetaMethod::fromSignal(&World::worldUpdated);
+    if (isSignalConnected(populationSignal))
+    {
+        emit populationChanged(humanCount(), zombieCount(), infectedCount(), m_time);
+    }
+    if (isSignalConnected(updatedSignal))
+    {
+        emit worldUpdated();
+    }
 }
 
-const std::vector<std::unique_ptr<WorldObject>> &World::objects() const
+const AgentStore &World::agents() const
 {
-    return m_objects;
+    return m_agents;
 }
 
 double World::time() const
@@ -229,14 +971,51 @@ double World::time() const
     return m_time;
 }
 
+std::uint64_t World::stepIndex() const
+{
+    return m_stepIndex;
+}
+
 int World::humanCount() const
 {
-    return std::count_if(m_objects.begin(), m_objects.end(),
-                         [](const std::unique_ptr<WorldObject> &ptr) { return ptr->type() == ObjType::Human; });
+    return m_counters.count(ObjType::Human);
 }
 
 int World::zombieCount() const
 {
-    return std::count_if(m_objects.begin(), m_objects.end(),
-                         [](const std::unique_ptr<WorldObject> &ptr) { return ptr->type() == ObjType::Zombie; });
+    return m_counters.count(ObjType::Zombie);
+}
+
+int World::infectedCount() const
+{
+    return m_counters.count(ObjType::Human, ObjStatus::Infected);
+}
+
+const PopulationCounters &World::counters() const
+{
+    return m_counters;
+}
+
+const World::StepProfile &World::lastStepProfile() const
+{
+    return m_profile;
+}
+
+const World::StepMetrics &World::lastStepMetrics() const
+{
+    return m_metrics;
+}
+
+void World::updateMetrics(int bites)
+{
+    const std::size_t count = m_agents.size();
+    m_metrics.time = m_time;
+    m_metrics.humans = humanCount();
+    m_metrics.zombies = zombieCount();
+    m_metrics.infected = infectedCount();
+    m_metrics.bites = bites;
+    m_metrics.meanSpeed = count > 0 ? m_stats.speedSum / static_cast<double>(count) : 0.0;
+    m_metrics.meanTargetDistance =
+        m_stats.targets > 0 ? m_stats.targetDistanceSum / static_cast<double>(m_stats.targets) : 0.0;
+    m_stats.clear();
 }
@@ -1,54 +1,259 @@
 #pragma once
 
+#include <QByteArray>
 #include <QObject>
 #include <QRectF>
+#include <QString>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <memory>
-#include <random>
 #include <vector>
 
-#include "worldobject.h"
+#include "agentstore.h"
+#include "bitebuffer.h"
+#include "flowfield.h"
+#include "human.h"
+#include "mortonorder.h"
+#include "neighborbatch.h"
+#include "populationcounters.h"
+#include "spatialgrid.h"
+#include "threadpool.h"
+#include "timingwheel.h"
+#include "zombie.h"
 
 class World : public QObject
 {
     Q_OBJECT
 public:
+    enum class QueryMode
+    {
+        Grid,
+        BruteForce
+    };
+
+    // Как зомби выбирают цель: ближайший человек по индексу соседей или поле преследования (одно поле
+    // на шаг, O(ячеек + зомби) вместо поиска на каждого зомби): издали зомби идёт по полю к источнику
+    // своей ячейки, рядом с ним — прямо к ближайшему человеку окрестности.
+    enum class PursuitMode
+    {
+        Nearest,
+        FlowField
+    };
+
+    // Длительности фаз последнего шага (нс) и число превращений за шаг.
+    struct StepProfile
+    {
+        std::int64_t reorderNs{0};
+        std::int64_t indexNs{0};
+        std::int64_t updateNs{0};
+        std::int64_t conversionNs{0};
+        std::int64_t totalNs{0};
+        int conversions{0};
+    };
+
+    // Сводка последнего шага: численность, укусы (превращения) и средние по агентам.
+    struct StepMetrics
+    {
+        double time{0.0};
+        int humans{0};
+        int zombies{0};
+        // Заражённые люди в инкубационном периоде (входят в humans).
+        int infected{0};
+        // Укушенные за шаг люди: заражённые или, без инкубации, сразу превращённые.
+        int bites{0};
+        double meanSpeed{0.0};
+        // Среднее расстояние от зомби до выбранной цели; 0, если целей не было.
+        double meanTargetDistance{0.0};
+    };
+
+    // Цель преследования и точка, к которой идти на этом шаге: сама цель или центр следующей
+    // ячейки поля преследования.
+    struct Pursuit
+    {
+        AgentRef target;
+        QPointF waypoint;
+    };
+
     explicit World(QObject *parent = nullptr);
+    ~World() override;
 
     void reset(int humans, int zombies);
+    void reset(int humans, int zombies, std::uint64_t seed);
+    std::uint64_t seed() const;
+
+    // Полное состояние (агенты, seed и номер шага счётного генератора, время, ожидающие превращения,
+    // параметры) плоским образом: заголовок и столбцы подряд. Восстановление — одно копирование на
+    // столбец, без выделений на агента; при ошибке мир остаётся пустым. Пул потоков не сохраняется.
+    QByteArray stateImage() const;
+    bool restoreState(const QByteArray &image);
+    bool saveState(const QString &path) const;
+    bool loadState(const QString &path);
 
     void setBounds(const QRectF &rect);
     QRectF bounds() const;
 
     void setDefaultBiteRadius(double radius);
     double defaultBiteRadius() const;
+    // Радиус по умолчанию и радиус всех уже существующих зомби (для ветвей восстановленного мира).
+    void applyBiteRadius(double radius);
+
+    // Средняя длительность инкубации (в единицах времени модели). Укушенный человек получает статус
+    // Infected и превращается через случайное время (распределение Эрланга порядка 2 с этим средним);
+    // 0 — превращение на том же шаге.
+    void setIncubationTime(double mean);
+    double incubationTime() const;
+
+    // Радиус, в котором люди замечают зомби и убегают от них; 0 — люди бродят, не глядя на зомби.
+    // Обзор — запрос в радиусе по сетке зомби, поэтому его цена зависит от числа зомби рядом, а не от
+    // численности мира: при постоянной плотности она постоянна, в мире фиксированного размера растёт с N.
+    void setPerceptionRadius(double radius);
+    double perceptionRadius() const;
+
+    void setQueryMode(QueryMode mode);
+    QueryMode queryMode() const;
+
+    // 0 (по умолчанию) — около двух агентов типа на ячейку, размер пересчитывается при каждой перестройке.
+    void setGridCellSize(double size);
+    double gridCellSize() const;
+
+    void setPursuitMode(PursuitMode mode);
+    PursuitMode pursuitMode() const;
+    // 0 — около одного человека на ячейку поля.
+    void setFlowCellSize(double size);
+    double flowCellSize() const;
+
+    // Раз в K шагов строки каждого типа переставляются по кривой Мортона над bounds(), чтобы соседи
+    // в пространстве лежали рядом в памяти. K подстраивается по доле разрывов порядка, найденных при
+    // очередной сортировке. id агентов не меняются, слоты — меняются. Без обзора людей судьба агентов
+    // от перестановки не зависит; с обзором сумма отталкивания копится в порядке строк, и округление
+    // может разойтись в последнем бите.
+    void setSpatialReorder(bool enabled);
+    bool spatialReorder() const;
+    int reorderInterval() const;
+
+    // 1 — последовательный шаг в вызывающем потоке, 0 — по числу аппаратных потоков.
+    void setThreadCount(int threads);
+    int threadCount() const;
+    // Пул шага; между шагами простаивает и может использоваться владельцем мира. nullptr при одном потоке.
+    ThreadPool *threadPool() const;
 
     void step(double dt);
 
-    const std::vector<std::unique_ptr<WorldObject>> &objects() const;
+    const AgentStore &agents() const;
     double time() const;
+    std::uint64_t stepIndex() const;
     int humanCount() const;
     int zombieCount() const;
+    int infectedCount() const;
+    const PopulationCounters &counters() const;
+    const StepProfile &lastStepProfile() const;
+    const StepMetrics &lastStepMetrics() const;
+
+    // Запросы по людям видят только незаражённых: человек в инкубации уже не цель для зомби.
+    AgentRef closestHuman(const QPointF &pos) const;
+    // Цель преследования для точки в текущем режиме PursuitMode.
+    Pursuit pursuit(const QPointF &pos) const;
+    std::vector<AgentRef> objectsInRadius(const QPointF &pos, double radius, ObjType type) const;
 
-    WorldObject *closestHuman(const QPointF &pos) const;
-    std::vector<WorldObject *> objectsInRadius(const QPointF &pos, double radius, ObjType type) const;
+    // Запросы без выделений памяти. fn(AgentIndex) вызывается для каждого агента типа type в радиусе,
+    // порядок обхода не задан.
+    template <typename Fn>
+    void forEachInRadius(const QPointF &pos, double radius, ObjType type, Fn &&fn) const;
+    // Слоты агентов в радиусе по возрастанию; out очищается, его ёмкость переиспользуется.
+    void objectsInRadius(const QPointF &pos, double radius, ObjType type, std::vector<AgentIndex> &out) const;
+
+    // Пакетные запросы для count точек: запросы одной ячейки сетки делят обход окрестности. Ответ на
+    // точку q — out.begin(q)..out.end(q); для closestHumans это ноль или один слот.
+    void objectsInRadius(const QPointF *points, std::size_t count, double radius, ObjType type,
+                         NeighborBatch &out) const;
+    void closestHumans(const QPointF *points, std::size_t count, NeighborBatch &out) const;
 
 signals:
-    void populationChanged(int humans, int zombies, double time);
+    void populationChanged(int humans, int zombies, int infected, double time);
     void worldUpdated();
 
-private slots:
-    void onBite(WorldObject *victim);
-
 private:
     void spawnHumans(int count);
     void spawnZombies(int count);
-    void connectObject(WorldObject *obj);
-    void processPendingConversions();
+    void spawn(ObjType type, int count, double initialSpeed);
+    WorldObject &behaviorFor(ObjType type);
+    void updateRange(std::size_t begin, std::size_t end, int worker, double dt);
+    void mergeWorkerResults();
+    int processPendingConversions(double dt, int &bitten);
+    void convertToZombie(AgentIndex victim);
+    void updateMetrics(int bites);
+    void reorderAgents();
+    void rebuildIndex() const;
+    const SpatialGrid &gridFor(ObjType type) const;
 
-    std::mt19937 m_rng;
+    std::uint64_t m_seed{0};
+    std::uint64_t m_stepIndex{0};
     QRectF m_bounds{0.0, 0.0, 120.0, 80.0};
-    std::vector<std::unique_ptr<WorldObject>> m_objects;
-    std::vector<WorldObject *> m_pendingConversions;
+    AgentStore m_agents;
+    Human m_humanBehavior;
+    Zombie m_zombieBehavior;
+    struct WorkerScratch
+    {
+        std::vector<AgentIndex> bites;
+        PopulationCounters counters;
+        StepStats stats;
+    };
+
+    BiteBuffer m_bites;
+    // Сроки превращения заражённых по номеру шага; ключ — id агента, слот берётся через slotOf.
+    TimingWheel m_incubation;
+    std::vector<std::uint32_t> m_due;
+    std::vector<AgentIndex> m_converting;
+    double m_incubationTime{0.0};
+    double m_perceptionRadius{0.0};
+    PopulationCounters m_counters;
+    std::vector<WorkerScratch> m_workers;
+    std::unique_ptr<ThreadPool> m_pool;
     double m_time{0.0};
     double m_defaultBiteRadius{6.0};
+    StepProfile m_profile;
+    StepStats m_stats;
+    StepMetrics m_metrics;
+
+    QueryMode m_queryMode{QueryMode::Grid};
+    mutable SpatialGrid m_humanGrid;
+    mutable SpatialGrid m_zombieGrid;
+    PursuitMode m_pursuitMode{PursuitMode::Nearest};
+    bool m_reorderEnabled{true};
+    int m_reorderInterval{0};
+    std::uint64_t m_nextReorder{0};
+    MortonOrder m_morton;
+    std::vector<std::uint32_t> m_typeOrder;
+    std::vector<AgentIndex> m_order;
+    mutable FlowField m_flowField;
+    // Слоты здоровых людей, из которых строятся индекс людей и поле преследования.
+    mutable std::vector<AgentIndex> m_targets;
+    mutable bool m_indexDirty{true};
 };
+
+template <typename Fn>
+void World::forEachInRadius(const QPointF &pos, double radius, ObjType type, Fn &&fn) const
+{
+    if (m_queryMode == QueryMode::Grid)
+    {
+        gridFor(type).forEachInRadius(pos.x(), pos.y(), radius,
+                                      [&fn](std::uint32_t index, double, double) { fn(index); });
+        return;
+    }
+
+    const double *xs = m_agents.xs().data();
+    const double *ys = m_agents.ys().data();
+    const AgentIndex end = m_agents.typeEnd(type);
+    for (AgentIndex i = m_agents.typeBegin(type); i < end; ++i)
+    {
+        if (type == ObjType::Human && m_agents.status(i) == ObjStatus::Infected)
+        {
+            continue;
+        }
+        if (std::hypot(xs[i] - pos.x(), ys[i] - pos.y()) <= radius)
+        {
+            fn(i);
+        }
+    }
+}
@@ -1,59 +1,22 @@
 #include "worldobject.h"
 
-#include <algorithm>
+#include "agentstore.h"
+#include "populationcounters.h"
 
-WorldObject::WorldObject(ObjType type, QObject *parent) : QObject(parent), m_type(type) {}
-
-ObjType WorldObject::type() const
-{
-    return m_type;
-}
-
-const ObjState &WorldObject::state() const
-{
-    return m_state;
-}
-
-ObjState &WorldObject::mutableState()
-{
-    return m_state;
-}
-
-bool WorldObject::isBusy() const
-{
-    return m_busy;
-}
-
-void WorldObject::setBusy(bool busy)
+void StepContext::setStatus(AgentIndex index, ObjStatus status)
 {
-    m_busy = busy;
-}
-
-void WorldObject::integrate(double dt, const QRectF &bounds)
-{
-    QPointF next(m_state.pos.x() + m_state.vel.x() * dt, m_state.pos.y() + m_state.vel.y() * dt);
-
-    if (next.x() < bounds.left())
+    const ObjStatus old = agents.status(index);
+    if (old != status)
     {
-        next.setX(bounds.left());
-        m_state.vel.setX(-m_state.vel.x());
-    }
-    else if (next.x() > bounds.right())
-    {
-        next.setX(bounds.right());
-        m_state.vel.setX(-m_state.vel.x());
+        const ObjType type = agents.type(index);
+        counters.move(type, old, type, status);
+        agents.setStatus(index, status);
     }
+}
 
-    if (next.y() < bounds.top())
-    {
-        next.setY(bounds.top());
-        m_state.vel.setY(-m_state.vel.y());
-    }
-    else if (next.y() > bounds.bottom())
-    {
-        next.setY(bounds.bottom());
-        m_state.vel.setY(-m_state.vel.y());
-    }
+WorldObject::WorldObject(ObjType type, QObject *parent) : QObject(parent), m_type(type) {}
 
-    m_state.pos = next;
+ObjType WorldObject::type() const
+{
+    return m_type;
 }
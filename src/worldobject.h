@@ -2,23 +2,33 @@
 
 #include <QObject>
 #include <QPointF>
-#include <QRectF>
+#include <cstdint>
+#include <vector>
 
 class World;
+class AgentStore;
+class PopulationCounters;
 
-enum class ObjType
+using AgentIndex = std::uint32_t;
+using AgentId = std::uint32_t;
+
+enum class ObjType : std::uint8_t
 {
     Human,
     Zombie
 };
 
-enum class ObjStatus
+constexpr std::size_t kObjTypeCount = 2;
+
+enum class ObjStatus : std::uint8_t
 {
     Idle,
     Moving,
     Infected
 };
 
+constexpr std::size_t kObjStatusCount = 3;
+
 struct ObjState
 {
     ObjStatus curStatus{ObjStatus::Idle};
@@ -26,6 +36,47 @@ struct ObjState
     QPointF vel{0.0, 0.0};
 };
 
+// Сумматоры наблюдаемых величин шага: у каждого исполнителя свои, мир сводит их после прохода.
+struct StepStats
+{
+    double speedSum{0.0};
+    double targetDistanceSum{0.0};
+    std::uint64_t targets{0};
+
+    void clear() { *this = StepStats(); }
+    StepStats &operator+=(const StepStats &other)
+    {
+        speedSum += other.speedSum;
+        targetDistanceSum += other.targetDistanceSum;
+        targets += other.targets;
+        return *this;
+    }
+};
+
+// Всё, что видит поведение на шаге. Позиции в agents — снимок начала шага; писать можно только
+// в строку своего агента, укусы копятся в буфере исполнителя и сливаются миром после прохода.
+// Случайные числа берутся из CounterRng(seed, id агента, step). Статус меняется через setStatus,
+// чтобы приращение попало в счётчик исполнителя.
+struct StepContext
+{
+    const World &world;
+    AgentStore &agents;
+    std::vector<AgentIndex> &bites;
+    PopulationCounters &counters;
+    StepStats &stats;
+    double dt;
+    std::uint64_t seed;
+    std::uint64_t step;
+
+    void setStatus(AgentIndex index, ObjStatus status);
+};
+
+// Поведение одного типа агентов. Экземпляр общий для всех агентов этого типа,
+// а состояние конкретного агента лежит в столбцах AgentStore.
+// Шаг не проходит через виртуальный вызов на агента: каждый наследник объявляет невиртуальные
+// updateState(ctx, index) и updateRange(ctx, begin, end), где updateRange — цикл по строкам своего
+// типа в той же единице трансляции, поэтому updateState в нём встраивается. Мир вызывает
+// updateRange один раз на кусок диапазона типа (см. World::updateRange).
 class WorldObject : public QObject
 {
     Q_OBJECT
@@ -34,17 +85,8 @@ public:
     ~WorldObject() override = default;
 
     ObjType type() const;
-    const ObjState &state() const;
-    ObjState &mutableState();
-
-    bool isBusy() const;
-    void setBusy(bool busy);
-
-    virtual void updateState(World &world, double dt) = 0;
-    void integrate(double dt, const QRectF &bounds);
+    virtual double defaultSpeed() const = 0;
 
 protected:
     ObjType m_type;
-    ObjState m_state;
-    bool m_busy{false};
 };
@@ -1,70 +1,80 @@
 #include "zombie.h"
 
+#include "counterrng.h"
 #include "world.h"
 
-#include <QRandomGenerator>
 #include <QtMath>
 
 Zombie::Zombie(QObject *parent) : WorldObject(ObjType::Zombie, parent) {}
 
-void Zombie::setBiteRadius(double radius)
+double Zombie::defaultSpeed() const
 {
-    m_biteRadius = radius;
+    return 8.0;
 }
 
-double Zombie::biteRadius() const
-{
-    return m_biteRadius;
-}
-
-void Zombie::wander()
+void Zombie::wander(StepContext &ctx, AgentIndex index)
 {
+    AgentStore &agents = ctx.agents;
     const double jitter = 3.0;
-    auto *rng = QRandomGenerator::global();
-    const double dx = (rng->generateDouble() * 2.0 - 1.0) * jitter;
-    const double dy = (rng->generateDouble() * 2.0 - 1.0) * jitter;
+    CounterRng rng(ctx.seed, agents.id(index), ctx.step);
+    const double dx = rng.nextSigned() * jitter;
+    const double dy = rng.nextSigned() * jitter;
 
-    QPointF vel = m_state.vel + QPointF(dx, dy);
+    QPointF vel = agents.vel(index) + QPointF(dx, dy);
     const double len = std::hypot(vel.x(), vel.y());
     if (len > 1e-3)
     {
-        const double scale = m_speed / len;
+        const double scale = agents.speed(index) / len;
         vel.setX(vel.x() * scale);
         vel.setY(vel.y() * scale);
     }
 
-    m_state.vel = vel;
+    agents.setVel(index, vel);
 }
 
-void Zombie::updateState(World &world, double dt)
+void Zombie::updateState(StepContext &ctx, AgentIndex index)
 {
-    Q_UNUSED(dt)
+    AgentStore &agents = ctx.agents;
 
-    WorldObject *target = world.closestHuman(m_state.pos);
-    if (target != nullptr)
+    const QPointF pos = agents.pos(index);
+    const World::Pursuit pursuit = ctx.world.pursuit(pos);
+    const AgentRef &target = pursuit.target;
+    if (target)
     {
-        const QPointF diff = target->state().pos - m_state.pos;
+        const QPointF diff = target.pos() - pos;
         const double distance = std::hypot(diff.x(), diff.y());
+        ctx.stats.targetDistanceSum += distance;
+        ++ctx.stats.targets;
 
-        if (distance <= m_biteRadius)
+        if (distance <= agents.biteRadius(index))
         {
-            if (!m_busy)
+            if (!agents.isBusy(index))
             {
-                emit biteSignal(target);
-                m_busy = true;
+                ctx.bites.push_back(target.index());
+                agents.setBusy(index, true);
             }
-            m_state.vel = QPointF(0.0, 0.0);
+            agents.setVel(index, QPointF(0.0, 0.0));
             return;
         }
 
-        if (distance > 1e-3)
+        const QPointF heading = pursuit.waypoint - pos;
+        const double length = std::hypot(heading.x(), heading.y());
+        if (length > 1e-3)
         {
-            const double scale = m_speed / distance;
-            m_state.vel = QPointF(diff.x() * scale, diff.y() * scale);
+            const double scale = agents.speed(index) / length;
+            agents.setVel(index, QPointF(heading.x() * scale, heading.y() * scale));
         }
     }
     else
     {
-        wander();
+        wander(ctx, index);
+    }
+}
+
+void Zombie::updateRange(StepContext &ctx, AgentIndex begin, AgentIndex end)
+{
+    for (AgentIndex i = begin; i < end; ++i)
+    {
+        updateState(ctx, i);
     }
 }
@@ -2,23 +2,18 @@
 
 #include "worldobject.h"
 
-class Zombie : public WorldObject
+class Zombie final : public WorldObject
 {
     Q_OBJECT
 public:
     explicit Zombie(QObject *parent = nullptr);
 
-    void setBiteRadius(double radius);
-    double biteRadius() const;
+    double defaultSpeed() const override;
 
-    void updateState(World &world, double dt) override;
-
-signals:
-    void biteSignal(WorldObject *victim);
+    void updateState(StepContext &ctx, AgentIndex index);
+    // Строки [begin, end) — агенты этого типа.
+    void updateRange(StepContext &ctx, AgentIndex begin, AgentIndex end);
 
 private:
-    void wander();
-
-    double m_biteRadius{6.0};
-    double m_speed{8.0};
+    void wander(StepContext &ctx, AgentIndex index);
 };
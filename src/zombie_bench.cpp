@@ -0,0 +1,361 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "counterrng.h"
+#include "integrator.h"
+#include "world.h"
+
+namespace
+{
+std::atomic<long long> g_allocations{0};
+
+using Clock = std::chrono::steady_clock;
+
+double nsSince(Clock::time_point from)
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - from).count());
+}
+
+// Площадь мира на агента в замерах обзора (у мира по умолчанию — около 200 при 45 агентах).
+constexpr double kPerceptionAreaPerAgent = 64.0;
+// В мире по умолчанию (120×80) зомби в обзоре растут с N, и замер выше этого N слишком долгий.
+constexpr int kPerceptionFixedMaxAgents = 100000;
+
+struct Case
+{
+    int agents;
+    double zombieFraction;
+};
+
+QJsonObject runCase(const Case &c, int steps, int queries, int threads, double cellSize, World::PursuitMode pursuit,
+                    bool reorder, std::uint64_t seed)
+{
+    const int zombies = std::max(1, static_cast<int>(std::lround(c.agents * c.zombieFraction)));
+    const int humans = std::max(0, c.agents - zombies);
+
+    World world;
+    world.setThreadCount(threads);
+    world.setGridCellSize(cellSize);
+    world.setPursuitMode(pursuit);
+    world.setSpatialReorder(reorder);
+    world.reset(humans, zombies, seed);
+
+    world.step(0.1);
+
+    double totalNs = 0.0;
+    double reorderNs = 0.0;
+    double indexNs = 0.0;
+    double updateNs = 0.0;
+    double conversionNs = 0.0;
+    long long conversions = 0;
+    long long agentSteps = 0;
+
+    const long long allocBefore = g_allocations.load();
+    for (int s = 0; s < steps; ++s)
+    {
+        const auto population = static_cast<long long>(world.agents().size());
+        world.step(0.1);
+        const World::StepProfile &p = world.lastStepProfile();
+        totalNs += p.totalNs;
+        reorderNs += p.reorderNs;
+        indexNs += p.indexNs;
+        updateNs += p.updateNs;
+        conversionNs += p.conversionNs;
+        conversions += p.conversions;
+        agentSteps += population;
+    }
+    const long long stepAllocations = g_allocations.load() - allocBefore;
+
+    const QRectF b = world.bounds();
+    std::vector<QPointF> points(static_cast<std::size_t>(queries));
+    for (int q = 0; q < queries; ++q)
+    {
+        CounterRng rng(seed, static_cast<std::uint64_t>(q), 0);
+        points[static_cast<std::size_t>(q)] =
+            QPointF(b.left() + rng.nextDouble() * b.width(), b.top() + rng.nextDouble() * b.height());
+    }
+
+    std::size_t sink = 0;
+    Clock::time_point t0 = Clock::now();
+    for (const QPointF &p : points)
+    {
+        sink += world.closestHuman(p).index();
+    }
+    const double closestNs = nsSince(t0) / std::max(queries, 1);
+
+    const long long allocQueries = g_allocations.load();
+    t0 = Clock::now();
+    for (const QPointF &p : points)
+    {
+        sink += world.objectsInRadius(p, world.defaultBiteRadius(), ObjType::Zombie).size();
+    }
+    const double radiusNs = nsSince(t0) / std::max(queries, 1);
+    const long long radiusAllocations = g_allocations.load() - allocQueries;
+
+    // Повторно используемый буфер и пакет: первый прогон только наращивает ёмкость.
+    std::vector<AgentIndex> buffer;
+    for (const QPointF &p : points)
+    {
+        world.objectsInRadius(p, world.defaultBiteRadius(), ObjType::Zombie, buffer);
+    }
+    const long long allocBuffer = g_allocations.load();
+    t0 = Clock::now();
+    for (const QPointF &p : points)
+    {
+        world.objectsInRadius(p, world.defaultBiteRadius(), ObjType::Zombie, buffer);
+        sink += buffer.size();
+    }
+    const double bufferNs = nsSince(t0) / std::max(queries, 1);
+    const long long bufferAllocations = g_allocations.load() - allocBuffer;
+
+    NeighborBatch batch;
+    world.objectsInRadius(points.data(), points.size(), world.defaultBiteRadius(), ObjType::Zombie, batch);
+    const long long allocBatch = g_allocations.load();
+    t0 = Clock::now();
+    world.objectsInRadius(points.data(), points.size(), world.defaultBiteRadius(), ObjType::Zombie, batch);
+    const double batchNs = nsSince(t0) / std::max(queries, 1);
+    sink += batch.indices().size();
+    world.closestHumans(points.data(), points.size(), batch);
+    t0 = Clock::now();
+    world.closestHumans(points.data(), points.size(), batch);
+    const double closestBatchNs = nsSince(t0) / std::max(queries, 1);
+    const long long batchAllocations = g_allocations.load() - allocBatch;
+    sink += batch.indices().size();
+
+    if (sink == 42)
+    {
+        std::fputc(' ', stderr);
+    }
+
+    const double stepsD = std::max(steps, 1);
+    QJsonObject o;
+    o[QStringLiteral("agents")] = c.agents;
+    o[QStringLiteral("humans")] = humans;
+    o[QStringLiteral("zombies")] = zombies;
+    o[QStringLiteral("zombie_fraction")] = c.zombieFraction;
+    o[QStringLiteral("cell_size")] = world.gridCellSize();
+    o[QStringLiteral("steps")] = steps;
+    o[QStringLiteral("step_ns")] = totalNs / stepsD;
+    o[QStringLiteral("step_ns_per_agent")] = agentSteps > 0 ? totalNs / static_cast<double>(agentSteps) : 0.0;
+    o[QStringLiteral("reorder_ns_per_step")] = reorderNs / stepsD;
+    o[QStringLiteral("reorder_interval")] = world.spatialReorder() ? world.reorderInterval() : 0;
+    o[QStringLiteral("index_ns_per_step")] = indexNs / stepsD;
+    o[QStringLiteral("update_ns_per_step")] = updateNs / stepsD;
+    o[QStringLiteral("conversion_ns_per_step")] = conversionNs / stepsD;
+    o[QStringLiteral("conversions_per_step")] = static_cast<double>(conversions) / stepsD;
+    o[QStringLiteral("allocations_per_step")] = static_cast<double>(stepAllocations) / stepsD;
+    o[QStringLiteral("closest_human_ns")] = closestNs;
+    o[QStringLiteral("objects_in_radius_ns")] = radiusNs;
+    o[QStringLiteral("objects_in_radius_allocations")] = static_cast<double>(radiusAllocations) / std::max(queries, 1);
+    o[QStringLiteral("objects_in_radius_buffer_ns")] = bufferNs;
+    o[QStringLiteral("objects_in_radius_buffer_allocations")] =
+        static_cast<double>(bufferAllocations) / std::max(queries, 1);
+    o[QStringLiteral("objects_in_radius_batch_ns")] = batchNs;
+    o[QStringLiteral("closest_human_batch_ns")] = closestBatchNs;
+    // Выделения памяти за оба повторных пакета вместе.
+    o[QStringLiteral("batch_allocations")] = static_cast<double>(batchAllocations);
+    o[QStringLiteral("humans_left")] = world.humanCount();
+    return o;
+}
+
+// Обзор людей. При scaled мир растёт вместе с N (постоянная плотность), и зомби в радиусе обзора в среднем
+// столько же — цена на человека не зависит от N. Без scaled мир по умолчанию (как в GUI и zombie_sim):
+// плотность и число зомби в обзоре растут с N, а с ними и цена на человека. Отдельно меряется сам запрос
+// обзора по позициям всех людей и шаг с обзором и без.
+QJsonObject runPerceptionCase(int agents, bool scaled, int steps, int threads, double radius, std::uint64_t seed)
+{
+    const int zombies = std::max(1, agents / 10);
+    const int humans = std::max(0, agents - zombies);
+    const double side = std::sqrt(static_cast<double>(agents) * kPerceptionAreaPerAgent);
+    QRectF bounds = World().bounds();
+    if (scaled)
+    {
+        bounds = QRectF(0.0, 0.0, side * 1.5, side / 1.5);
+    }
+
+    double updateNs[2] = {0.0, 0.0};
+    double queryNs = 0.0;
+    long long perceived = 0;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        World world;
+        world.setThreadCount(threads);
+        world.setBounds(bounds);
+        world.setPerceptionRadius(pass == 1 ? radius : 0.0);
+        world.reset(humans, zombies, seed);
+        world.step(0.1);
+        for (int s = 0; s < steps; ++s)
+        {
+            world.step(0.1);
+            updateNs[pass] += world.lastStepProfile().updateNs;
+        }
+
+        if (pass == 1)
+        {
+            const AgentStore &store = world.agents();
+            const auto count = [&perceived](AgentIndex) { ++perceived; };
+            // Первый запрос перестраивает индекс после шага, в замер это не входит.
+            world.forEachInRadius(QPointF(), 0.0, ObjType::Zombie, [](AgentIndex) {});
+            const Clock::time_point t0 = Clock::now();
+            for (AgentIndex i = store.typeBegin(ObjType::Human); i < store.typeEnd(ObjType::Human); ++i)
+            {
+                world.forEachInRadius(store.pos(i), radius, ObjType::Zombie, count);
+            }
+            queryNs = nsSince(t0);
+        }
+    }
+
+    const double stepsD = std::max(steps, 1);
+    const double humansD = std::max(humans, 1);
+    QJsonObject o;
+    o[QStringLiteral("agents")] = agents;
+    o[QStringLiteral("humans")] = humans;
+    o[QStringLiteral("zombies")] = zombies;
+    o[QStringLiteral("bounds")] = scaled ? QStringLiteral("scaled") : QStringLiteral("fixed");
+    o[QStringLiteral("agents_per_area")] = agents / std::max(bounds.width() * bounds.height(), 1e-9);
+    o[QStringLiteral("perception_radius")] = radius;
+    o[QStringLiteral("perception_query_ns_per_human")] = queryNs / humansD;
+    o[QStringLiteral("zombies_perceived_per_human")] = static_cast<double>(perceived) / humansD;
+    o[QStringLiteral("update_ns_per_agent")] = updateNs[1] / stepsD / std::max(agents, 1);
+    o[QStringLiteral("update_ns_per_agent_without_perception")] = updateNs[0] / stepsD / std::max(agents, 1);
+    return o;
+}
+}
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("zombie_bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QStringLiteral("Микробенчмарк ядра модели: шаг, запросы соседей и превращения при N = 1e2…1e6, отчёт в JSON."));
+    parser.addHelpOption();
+
+    const QCommandLineOption maxOpt(QStringLiteral("max-agents"), QStringLiteral("Наибольшее N."), QStringLiteral("n"),
+                                    QStringLiteral("1000000"));
+    const QCommandLineOption stepsOpt(QStringLiteral("steps"), QStringLiteral("Измеряемых шагов на случай."),
+                                      QStringLiteral("n"), QStringLiteral("10"));
+    const QCommandLineOption queriesOpt(QStringLiteral("queries"), QStringLiteral("Запросов соседей на случай."),
+                                        QStringLiteral("n"), QStringLiteral("10000"));
+    const QCommandLineOption threadsOpt(QStringLiteral("threads"), QStringLiteral("Потоки шага (0 — все ядра)."),
+                                        QStringLiteral("n"), QStringLiteral("1"));
+    const QCommandLineOption cellOpt(QStringLiteral("cell"),
+                                     QStringLiteral("Размер ячейки сетки (0 — по плотности каждого типа)."),
+                                     QStringLiteral("size"), QStringLiteral("0"));
+    const QCommandLineOption pursuitOpt(QStringLiteral("pursuit"),
+                                        QStringLiteral("Выбор цели зомби: nearest или flow (поле расстояний)."),
+                                        QStringLiteral("mode"), QStringLiteral("nearest"));
+    const QCommandLineOption noReorderOpt(QStringLiteral("no-reorder"),
+                                          QStringLiteral("Не переставлять агентов по кривой Мортона."));
+    const QCommandLineOption perceptionOpt(QStringLiteral("perception"),
+                                           QStringLiteral("Радиус обзора людей в замерах обзора (0 — без них)."),
+                                           QStringLiteral("r"), QStringLiteral("15"));
+    const QCommandLineOption seedOpt(QStringLiteral("seed"), QStringLiteral("Seed."), QStringLiteral("seed"),
+                                     QStringLiteral("12345"));
+    const QCommandLineOption outputOpt(QStringLiteral("output"), QStringLiteral("JSON-файл (по умолчанию stdout)."),
+                                       QStringLiteral("file"));
+
+    parser.addOptions({maxOpt, stepsOpt, queriesOpt, threadsOpt, cellOpt, pursuitOpt, noReorderOpt, perceptionOpt,
+                       seedOpt, outputOpt});
+    parser.process(app);
+
+    const int maxAgents = parser.value(maxOpt).toInt();
+    const int steps = parser.value(stepsOpt).toInt();
+    const int queries = parser.value(queriesOpt).toInt();
+    const int threads = parser.value(threadsOpt).toInt();
+    const double cell = parser.value(cellOpt).toDouble();
+    const quint64 seed = parser.value(seedOpt).toULongLong();
+    const bool flow = parser.value(pursuitOpt) == QLatin1String("flow");
+    const World::PursuitMode pursuit = flow ? World::PursuitMode::FlowField : World::PursuitMode::Nearest;
+    const bool reorder = !parser.isSet(noReorderOpt);
+    const double perception = parser.value(perceptionOpt).toDouble();
+
+    QJsonArray results;
+    for (int n = 100; n <= maxAgents; n *= 10)
+    {
+        for (double fraction : {0.01, 0.1, 0.5})
+        {
+            const QJsonObject r = runCase({n, fraction}, steps, queries, threads, cell, pursuit, reorder, seed);
+            std::fprintf(stderr, "N=%d zombies=%.2f: %.1f ns/agent-step, %.1f alloc/step\n", n, fraction,
+                         r.value(QStringLiteral("step_ns_per_agent")).toDouble(),
+                         r.value(QStringLiteral("allocations_per_step")).toDouble());
+            results.append(r);
+        }
+    }
+
+    QJsonArray perceptionResults;
+    for (bool scaled : {true, false})
+    {
+        const int limit = scaled ? maxAgents : std::min(maxAgents, kPerceptionFixedMaxAgents);
+        for (int n = 1000; perception > 0.0 && n <= limit; n *= 10)
+        {
+            const QJsonObject r = runPerceptionCase(n, scaled, steps, threads, perception, seed);
+            std::fprintf(stderr, "perception N=%d (%s bounds): %.1f ns/human query, %.2f zombies in range\n", n,
+                         scaled ? "scaled" : "fixed",
+                         r.value(QStringLiteral("perception_query_ns_per_human")).toDouble(),
+                         r.value(QStringLiteral("zombies_perceived_per_human")).toDouble());
+            perceptionResults.append(r);
+        }
+    }
+
+    QJsonObject root;
+    root[QStringLiteral("benchmark")] = QStringLiteral("zombie_core");
+    root[QStringLiteral("seed")] = QString::number(seed);
+    root[QStringLiteral("threads")] = threads;
+    root[QStringLiteral("pursuit")] = flow ? QStringLiteral("flow") : QStringLiteral("nearest");
+    root[QStringLiteral("reorder")] = reorder;
+    root[QStringLiteral("integrator")] = QString::fromLatin1(integrator::implementationName());
+    root[QStringLiteral("results")] = results;
+    root[QStringLiteral("perception")] = perceptionResults;
+
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOpt))
+    {
+        QFile file(parser.value(outputOpt));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            std::fprintf(stderr, "zombie_bench: не удалось открыть %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+        file.write(json);
+    }
+    else
+    {
+        std::fwrite(json.constData(), 1, static_cast<std::size_t>(json.size()), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,333 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "ensemble.h"
+#include "trajectory.h"
+#include "world.h"
+
+namespace
+{
+void writeBand(QTextStream &out, const EnsembleBand &band, int i)
+{
+    out << ',' << band.mean[i] << ',' << band.stddev[i] * band.stddev[i] << ',' << band.low[i] << ','
+        << band.median[i] << ',' << band.high[i];
+}
+
+void writeSample(QTextStream &out, qint64 step, const World &world)
+{
+    const World::StepMetrics &m = world.lastStepMetrics();
+    out << step << ',' << QString::number(m.time, 'f', 6) << ',' << m.humans << ',' << m.zombies << ',' << m.infected
+        << ',' << m.bites << ',' << QString::number(m.meanSpeed, 'f', 6) << ','
+        << QString::number(m.meanTargetDistance, 'f', 6) << '\n';
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("zombie_sim"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Пакетный прогон модели без GUI, ряд численности пишется в CSV."));
+    parser.addHelpOption();
+
+    const QCommandLineOption humansOpt(QStringLiteral("humans"), QStringLiteral("Начальное число людей."),
+                                       QStringLiteral("n"), QStringLiteral("40"));
+    const QCommandLineOption zombiesOpt(QStringLiteral("zombies"), QStringLiteral("Начальное число зомби."),
+                                        QStringLiteral("n"), QStringLiteral("5"));
+    const QCommandLineOption dtOpt(QStringLiteral("dt"), QStringLiteral("Шаг по времени."), QStringLiteral("dt"),
+                                   QStringLiteral("0.1"));
+    const QCommandLineOption biteOpt(QStringLiteral("bite-radius"), QStringLiteral("Радиус заражения."),
+                                     QStringLiteral("r"), QStringLiteral("6.0"));
+    const QCommandLineOption incubationOpt(QStringLiteral("incubation"),
+                                           QStringLiteral("Средняя длительность инкубации (0 — превращение сразу)."),
+                                           QStringLiteral("t"), QStringLiteral("0"));
+    const QCommandLineOption perceptionOpt(QStringLiteral("perception"),
+                                           QStringLiteral("Радиус, в котором люди замечают зомби и убегают "
+                                                          "(0 — не убегают)."),
+                                           QStringLiteral("r"), QStringLiteral("0"));
+    const QCommandLineOption cellOpt(QStringLiteral("cell"),
+                                     QStringLiteral("Размер ячейки сетки соседей (0 — по плотности каждого типа)."),
+                                     QStringLiteral("size"), QStringLiteral("0"));
+    const QCommandLineOption seedOpt(QStringLiteral("seed"), QStringLiteral("Seed генератора."),
+                                     QStringLiteral("seed"), QStringLiteral("1"));
+    const QCommandLineOption stepsOpt(QStringLiteral("steps"), QStringLiteral("Число шагов."), QStringLiteral("n"),
+                                      QStringLiteral("1000"));
+    const QCommandLineOption threadsOpt(QStringLiteral("threads"),
+                                        QStringLiteral("Потоки шага (0 — все ядра)."), QStringLiteral("n"),
+                                        QStringLiteral("0"));
+    const QCommandLineOption outputOpt(QStringLiteral("output"),
+                                       QStringLiteral("Файл для ряда численности (по умолчанию stdout)."),
+                                       QStringLiteral("file"));
+    const QCommandLineOption everyOpt(QStringLiteral("every"), QStringLiteral("Писать каждый n-й шаг."),
+                                      QStringLiteral("n"), QStringLiteral("1"));
+
+    const QCommandLineOption runsOpt(QStringLiteral("runs"),
+                                     QStringLiteral("Число прогонов ансамбля; при n > 1 пишутся среднее, дисперсия и "
+                                                    "квантили 5/50/95%."),
+                                     QStringLiteral("n"), QStringLiteral("1"));
+    const QCommandLineOption recordOpt(QStringLiteral("record"),
+                                       QStringLiteral("Файл траектории (каждый шаг, формат ztrj)."),
+                                       QStringLiteral("file"));
+
+    const QCommandLineOption pursuitOpt(QStringLiteral("pursuit"),
+                                        QStringLiteral("Выбор цели зомби: nearest — ближайший человек, flow — поле "
+                                                       "расстояний."),
+                                        QStringLiteral("mode"), QStringLiteral("nearest"));
+    const QCommandLineOption loadOpt(QStringLiteral("load"),
+                                     QStringLiteral("Начать с сохранённого состояния мира вместо --humans/--zombies."),
+                                     QStringLiteral("file"));
+    const QCommandLineOption saveOpt(QStringLiteral("save"), QStringLiteral("Сохранить состояние мира после прогона."),
+                                     QStringLiteral("file"));
+    const QCommandLineOption forkOpt(QStringLiteral("fork"),
+                                     QStringLiteral("После прогона разветвить мир по радиусам укуса (через запятую); "
+                                                    "в CSV пишутся ряды ветвей."),
+                                     QStringLiteral("r1,r2,..."));
+    const QCommandLineOption forkStepsOpt(QStringLiteral("fork-steps"), QStringLiteral("Число шагов каждой ветви."),
+                                          QStringLiteral("n"), QStringLiteral("1000"));
+
+    parser.addOptions({humansOpt, zombiesOpt, dtOpt, biteOpt, incubationOpt, perceptionOpt, cellOpt, seedOpt,
+                       stepsOpt, threadsOpt, outputOpt, everyOpt, runsOpt, recordOpt, pursuitOpt, loadOpt, saveOpt,
+                       forkOpt, forkStepsOpt});
+    parser.process(app);
+
+    const int humans = parser.value(humansOpt).toInt();
+    const int zombies = parser.value(zombiesOpt).toInt();
+    const double dt = parser.value(dtOpt).toDouble();
+    const double biteRadius = parser.value(biteOpt).toDouble();
+    const double incubation = parser.value(incubationOpt).toDouble();
+    const double perception = parser.value(perceptionOpt).toDouble();
+    const double cell = parser.value(cellOpt).toDouble();
+    const quint64 seed = parser.value(seedOpt).toULongLong();
+    const qint64 steps = parser.value(stepsOpt).toLongLong();
+    const int threads = parser.value(threadsOpt).toInt();
+    const qint64 every = std::max<qint64>(1, parser.value(everyOpt).toLongLong());
+    const int runs = parser.value(runsOpt).toInt();
+    const World::PursuitMode pursuit = parser.value(pursuitOpt) == QLatin1String("flow")
+                                           ? World::PursuitMode::FlowField
+                                           : World::PursuitMode::Nearest;
+
+    QFile file;
+    if (parser.isSet(outputOpt))
+    {
+        file.setFileName(parser.value(outputOpt));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        {
+            std::fprintf(stderr, "zombie_sim: не удалось открыть %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+    }
+    else if (!file.open(stdout, QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return 1;
+    }
+
+    QTextStream out(&file);
+
+    if (runs > 1)
+    {
+        EnsembleConfig cfg;
+        cfg.runs = runs;
+        cfg.humans = humans;
+        cfg.zombies = zombies;
+        cfg.dt = dt;
+        cfg.biteRadius = biteRadius;
+        cfg.incubation = incubation;
+        cfg.perception = perception;
+        cfg.pursuit = pursuit;
+        cfg.cellSize = cell;
+        cfg.steps = static_cast<int>(steps);
+        cfg.seed = seed;
+        cfg.threads = threads;
+
+        QElapsedTimer timer;
+        timer.start();
+        const EnsembleResult result = EnsembleRunner(cfg).run();
+
+        out << "step,time,humans_mean,humans_var,humans_q05,humans_q50,humans_q95,"
+               "zombies_mean,zombies_var,zombies_q05,zombies_q50,zombies_q95\n";
+        for (int i = 0; i < result.time.size(); ++i)
+        {
+            if (i % every != 0 && i != result.time.size() - 1)
+            {
+                continue;
+            }
+            out << i << ',' << QString::number(result.time[i], 'f', 6);
+            writeBand(out, result.humans, i);
+            writeBand(out, result.zombies, i);
+            out << '\n';
+        }
+        out.flush();
+
+        std::fprintf(stderr, "zombie_sim: ансамбль из %d прогонов по %lld шагов за %.3f с\n", runs,
+                     static_cast<long long>(steps), timer.nsecsElapsed() * 1e-9);
+        return 0;
+    }
+
+    QVector<ForkBranch> branches;
+    if (parser.isSet(forkOpt))
+    {
+        const QStringList radii = parser.value(forkOpt).split(QLatin1Char(','));
+        for (const QString &r : radii)
+        {
+            if (r.trimmed().isEmpty())
+            {
+                continue;
+            }
+            ForkBranch branch;
+            branch.biteRadius = r.toDouble();
+            branch.dt = dt;
+            branches.append(branch);
+        }
+    }
+    const bool fork = !branches.isEmpty();
+
+    World world;
+    world.setDefaultBiteRadius(biteRadius);
+    world.setThreadCount(threads);
+    world.setPursuitMode(pursuit);
+    world.setIncubationTime(incubation);
+    world.setPerceptionRadius(perception);
+    world.setGridCellSize(cell);
+    if (parser.isSet(loadOpt))
+    {
+        if (!world.loadState(parser.value(loadOpt)))
+        {
+            std::fprintf(stderr, "zombie_sim: не удалось загрузить состояние %s\n", qPrintable(parser.value(loadOpt)));
+            return 1;
+        }
+        // Параметры из образа заменяют значения по умолчанию, но не явно заданные ключи.
+        if (parser.isSet(biteOpt))
+        {
+            world.applyBiteRadius(biteRadius);
+        }
+        if (parser.isSet(pursuitOpt))
+        {
+            world.setPursuitMode(pursuit);
+        }
+        if (parser.isSet(incubationOpt))
+        {
+            world.setIncubationTime(incubation);
+        }
+        if (parser.isSet(perceptionOpt))
+        {
+            world.setPerceptionRadius(perception);
+        }
+        if (parser.isSet(cellOpt))
+        {
+            world.setGridCellSize(cell);
+        }
+    }
+    else
+    {
+        world.reset(humans, zombies, seed);
+    }
+
+    if (!fork)
+    {
+        out << "step,time,humans,zombies,infected,bites,mean_speed,mean_target_distance\n";
+        writeSample(out, 0, world);
+    }
+
+    TrajectoryRecorder recorder;
+    const bool recording = parser.isSet(recordOpt);
+    const auto recordFailed = [&] {
+        std::fprintf(stderr, "zombie_sim: ошибка записи траектории %s: %s\n", qPrintable(parser.value(recordOpt)),
+                     qPrintable(recorder.errorString()));
+        return 1;
+    };
+    if (recording)
+    {
+        if (!recorder.open(parser.value(recordOpt), world))
+        {
+            std::fprintf(stderr, "zombie_sim: не удалось открыть %s: %s\n", qPrintable(parser.value(recordOpt)),
+                         qPrintable(recorder.errorString()));
+            return 1;
+        }
+        if (!recorder.capture(world))
+        {
+            return recordFailed();
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 done = 0;
+    while (done < steps)
+    {
+        world.step(dt);
+        if (recording && !recorder.capture(world))
+        {
+            return recordFailed();
+        }
+        ++done;
+        if (!fork && (done % every == 0 || done == steps))
+        {
+            writeSample(out, done, world);
+        }
+    }
+    if (recording && !recorder.close())
+    {
+        return recordFailed();
+    }
+    if (recording && recorder.skippedFrames() > 0)
+    {
+        std::fprintf(stderr, "zombie_sim: диск не успевал, пропущено кадров траектории: %llu\n",
+                     static_cast<unsigned long long>(recorder.skippedFrames()));
+    }
+
+    const double seconds = std::max(timer.nsecsElapsed() * 1e-9, 1e-9);
+    std::fprintf(stderr, "zombie_sim: %lld шагов за %.3f с (%.1f шагов/с, %.3g агенто-шагов/с)\n",
+                 static_cast<long long>(done), seconds, done / seconds,
+                 static_cast<double>(done) * static_cast<double>(world.agents().size()) / seconds);
+
+    if (parser.isSet(saveOpt) && !world.saveState(parser.value(saveOpt)))
+    {
+        std::fprintf(stderr, "zombie_sim: не удалось сохранить состояние %s\n", qPrintable(parser.value(saveOpt)));
+        return 1;
+    }
+
+    if (fork)
+    {
+        const int forkSteps = parser.value(forkStepsOpt).toInt();
+        timer.restart();
+        const QVector<ForkResult> results = ForkRunner(world, forkSteps, threads).run(branches);
+        for (const ForkResult &r : results)
+        {
+            if (!r.restored)
+            {
+                std::fprintf(stderr, "zombie_sim: ветвь с радиусом %g не восстановилась из образа мира\n",
+                             r.branch.biteRadius);
+                return 1;
+            }
+        }
+
+        // Номера шагов ветвей продолжают нумерацию исходного мира.
+        const qint64 origin = static_cast<qint64>(world.stepIndex());
+        out << "branch,bite_radius,step,time,humans,zombies\n";
+        for (int b = 0; b < results.size(); ++b)
+        {
+            const ForkResult &r = results[b];
+            for (int i = 0; i < r.time.size(); ++i)
+            {
+                if (i % every != 0 && i != r.time.size() - 1)
+                {
+                    continue;
+                }
+                out << b << ',' << r.branch.biteRadius << ',' << origin + i << ','
+                    << QString::number(r.time[i], 'f', 6) << ',' << r.humans[i] << ',' << r.zombies[i] << '\n';
+            }
+        }
+        std::fprintf(stderr, "zombie_sim: %d ветвей по %d шагов за %.3f с\n", static_cast<int>(results.size()),
+                     forkSteps, timer.nsecsElapsed() * 1e-9);
+    }
+    out.flush();
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Хранилище агентов: строки разбиты на диапазоны по типу, slotOf обратен id, а данные каждого агента
+// остаются при нём, как бы ни переставлялись строки и через плоский образ.
+
+#include <vector>
+
+#include "agentstore.h"
+#include "testing.h"
+#include "threadpool.h"
+
+namespace
+{
+struct Expected
+{
+    ObjType type;
+    double x;
+    double speed;
+};
+
+// Инварианты хранилища и совпадение строк с эталоном, индексированным по id.
+void checkStore(const AgentStore &store, const std::vector<Expected> &expected)
+{
+    CHECK(store.size() == expected.size());
+    CHECK(store.nextId() == expected.size());
+    CHECK(store.typeBegin(ObjType::Human) == 0);
+    CHECK(store.typeEnd(ObjType::Human) == store.typeBegin(ObjType::Zombie));
+    CHECK(store.typeEnd(ObjType::Zombie) == store.size());
+
+    std::vector<int> seen(expected.size(), 0);
+    for (AgentIndex i = 0; i < store.size(); ++i)
+    {
+        const AgentId id = store.id(i);
+        CHECK(id < expected.size());
+        if (id >= expected.size())
+        {
+            continue;
+        }
+        ++seen[id];
+        CHECK(store.slotOf(id) == i);
+        const ObjType type = store.type(i);
+        CHECK(i >= store.typeBegin(type) && i < store.typeEnd(type));
+        CHECK(type == expected[id].type);
+        CHECK(store.pos(i).x() == expected[id].x);
+        CHECK(store.speed(i) == expected[id].speed);
+        CHECK(store.at(i).id() == id);
+    }
+    for (int count : seen)
+    {
+        CHECK(count == 1);
+    }
+}
+}
+
+int main()
+{
+    AgentStore store;
+    std::vector<Expected> expected;
+    CHECK(store.empty());
+
+    // Типы вперемешку: каждый новый человек проходит назад через диапазон зомби.
+    for (int k = 0; k < 200; ++k)
+    {
+        const ObjType type = (k % 3 == 0) ? ObjType::Zombie : ObjType::Human;
+        const double x = 0.5 * k;
+        const double speed = 1.0 + k;
+        const AgentIndex slot = store.add(type, QPointF(x, -x), QPointF(1.0, 0.0), speed, 2.0);
+        CHECK(store.type(slot) == type);
+        CHECK(store.id(slot) == static_cast<AgentId>(k));
+        expected.push_back({type, x, speed});
+    }
+    checkStore(store, expected);
+    CHECK(store.typeEnd(ObjType::Human) == 133);
+
+    // Смена типа обменом с краем диапазона: первый, последний и средний человек, затем обратно.
+    for (AgentId id : {0u, 199u, 100u, 2u, 1u})
+    {
+        const ObjType to = expected[id].type == ObjType::Human ? ObjType::Zombie : ObjType::Human;
+        const AgentIndex slot = store.changeType(store.slotOf(id), to);
+        CHECK(store.id(slot) == id);
+        CHECK(store.type(slot) == to);
+        expected[id].type = to;
+        checkStore(store, expected);
+    }
+    // Жертвы одного шага обрабатываются по убыванию слота, как в World::processPendingConversions.
+    for (AgentIndex slot = store.typeEnd(ObjType::Human); slot-- > 0;)
+    {
+        if (slot % 4 == 0)
+        {
+            expected[store.id(slot)].type = ObjType::Zombie;
+            store.changeType(slot, ObjType::Zombie);
+        }
+    }
+    checkStore(store, expected);
+
+    // Перестановка внутри диапазонов типов: каждый диапазон задом наперёд, затем циклический сдвиг.
+    ThreadPool pool(3);
+    for (ThreadPool *p : {static_cast<ThreadPool *>(nullptr), &pool})
+    {
+        std::vector<AgentIndex> order(store.size());
+        for (ObjType type : {ObjType::Human, ObjType::Zombie})
+        {
+            const AgentIndex begin = store.typeBegin(type);
+            const AgentIndex end = store.typeEnd(type);
+            for (AgentIndex k = begin; k < end; ++k)
+            {
+                order[k] = p == nullptr ? end - 1 - (k - begin) : begin + (k - begin + 7) % (end - begin);
+            }
+        }
+        store.permute(order, p);
+        checkStore(store, expected);
+    }
+
+    // Образ: копия совпадает построчно, несогласованные границы диапазонов отвергаются.
+    std::vector<unsigned char> image(AgentStore::imageBytes(store.size()));
+    store.writeImage(image.data());
+    AgentStore copy;
+    CHECK(copy.readImage(image.data(), store.size(), store.typeBegins(), store.nextId()));
+    checkStore(copy, expected);
+    for (AgentIndex i = 0; i < store.size(); ++i)
+    {
+        CHECK(copy.id(i) == store.id(i));
+    }
+    std::array<AgentIndex, kObjTypeCount + 1> shifted = store.typeBegins();
+    ++shifted[1];
+    AgentStore rejected;
+    CHECK(!rejected.readImage(image.data(), store.size(), shifted, store.nextId()));
+
+    store.clear();
+    expected.clear();
+    checkStore(store, expected);
+
+    return testResult("test_agentstore");
+}
@@ -0,0 +1,44 @@
+// Буфер укусов: жертва учитывается один раз за шаг, порядок регистрации сохраняется, clear готовит
+// буфер к следующему шагу.
+
+#include <vector>
+
+#include "bitebuffer.h"
+#include "testing.h"
+
+int main()
+{
+    BiteBuffer bites;
+    bites.resize(1000);
+    CHECK(bites.empty());
+
+    const std::vector<AgentIndex> order = {5, 64, 63, 999, 0, 128};
+    for (AgentIndex victim : order)
+    {
+        CHECK(bites.record(victim));
+    }
+    // Повторные укусы той же жертвы на этом шаге отбрасываются.
+    CHECK(!bites.record(64));
+    CHECK(!bites.record(5));
+    CHECK(!bites.record(999));
+    CHECK(bites.victims() == order);
+    CHECK(bites.size() == order.size());
+
+    bites.clear();
+    CHECK(bites.empty());
+    for (AgentIndex victim : order)
+    {
+        CHECK(bites.record(victim));
+    }
+    CHECK(bites.victims() == order);
+
+    // Слот за пределами resize расширяет битсет, а не пишет мимо него.
+    CHECK(bites.record(5000));
+    CHECK(!bites.record(5000));
+    bites.clear();
+    CHECK(bites.record(5000));
+    CHECK(bites.record(4999));
+    CHECK(bites.size() == 2);
+
+    return testResult("test_bitebuffer");
+}
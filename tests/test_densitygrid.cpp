@@ -0,0 +1,63 @@
+// Гистограмма плотности: каждая точка попадает ровно в одну ячейку, точки за границей мира,
+// бесконечности и NaN прижимаются к краю, а раскладка на пуле совпадает с последовательной.
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "counterrng.h"
+#include "densitygrid.h"
+#include "testing.h"
+#include "threadpool.h"
+
+int main()
+{
+    const QRectF bounds(-50.0, 20.0, 400.0, 300.0);
+    DensityGrid grid;
+    grid.configure(bounds, 40, 30);
+    CHECK(grid.cellCount() == 1200);
+
+    // Края, выход за границу далеко за пределы int, бесконечности и NaN.
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const std::vector<double> edgeX = {-50.0, 350.0, -1e300, 1e300, -inf, inf, nan, 0.0};
+    const std::vector<double> edgeY = {20.0, 320.0, 1e300, -1e300, nan, 25.0, inf, -inf};
+    std::vector<std::uint32_t> out(grid.cellCount(), 7u);
+    grid.bin(edgeX.data(), edgeY.data(), edgeX.size(), out.data(), nullptr);
+    CHECK(std::accumulate(out.begin(), out.end(), 0ull) == edgeX.size());
+    CHECK(out[0] == 2); // (-50, 20) и (-inf, NaN)
+    CHECK(out[29 * 40 + 39] == 1); // (350, 320)
+    CHECK(out[29 * 40] == 2); // (-1e300, 1e300) и (NaN, inf)
+    CHECK(out[39] == 2); // (1e300, -1e300) и (inf, 25)
+    CHECK(out[5] == 1); // (0, -inf)
+
+    // Много точек с частью выбросов: последовательная раскладка и раскладка на пуле совпадают.
+    const std::size_t count = 100000;
+    std::vector<double> xs(count);
+    std::vector<double> ys(count);
+    CounterRng rng(11, 0, 0);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        xs[i] = bounds.left() - 20.0 + rng.nextDouble() * (bounds.width() + 40.0);
+        ys[i] = bounds.top() - 20.0 + rng.nextDouble() * (bounds.height() + 40.0);
+        if (i % 997 == 0)
+        {
+            xs[i] = nan;
+        }
+    }
+    std::vector<std::uint32_t> serial(grid.cellCount());
+    grid.bin(xs.data(), ys.data(), count, serial.data(), nullptr);
+    CHECK(std::accumulate(serial.begin(), serial.end(), 0ull) == count);
+
+    ThreadPool pool(4);
+    std::vector<std::uint32_t> parallel(grid.cellCount(), 1u);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        grid.bin(xs.data(), ys.data(), count, parallel.data(), &pool);
+        CHECK(parallel == serial);
+    }
+
+    return testResult("test_densitygrid");
+}
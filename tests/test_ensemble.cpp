@@ -0,0 +1,122 @@
+// Ансамбль: полосы совпадают с последовательной свёрткой прогонов по номерам, поэтому не зависят от
+// числа потоков; параметры мира (режим преследования, ячейка сетки) доходят до каждого прогона.
+
+#include <vector>
+
+#include "ensemble.h"
+#include "streamingstats.h"
+#include "testing.h"
+#include "world.h"
+
+namespace
+{
+struct Reference
+{
+    std::vector<RunningStats> stats;
+    std::vector<P2Quantile> low;
+    std::vector<P2Quantile> median;
+    std::vector<P2Quantile> high;
+};
+
+// Прогоны по одному в порядке номеров — то, что должен дать EnsembleRunner при любом числе потоков.
+EnsembleBand referenceBand(const EnsembleConfig &cfg, bool zombies)
+{
+    const auto samples = static_cast<std::size_t>(cfg.steps) + 1;
+    Reference ref{std::vector<RunningStats>(samples), std::vector<P2Quantile>(samples, P2Quantile(cfg.lowQuantile)),
+                  std::vector<P2Quantile>(samples, P2Quantile(0.5)),
+                  std::vector<P2Quantile>(samples, P2Quantile(cfg.highQuantile))};
+    for (int run = 0; run < cfg.runs; ++run)
+    {
+        World world;
+        world.setDefaultBiteRadius(cfg.biteRadius);
+        world.setIncubationTime(cfg.incubation);
+        world.setPerceptionRadius(cfg.perception);
+        world.setPursuitMode(cfg.pursuit);
+        world.setGridCellSize(cfg.cellSize);
+        world.reset(cfg.humans, cfg.zombies, EnsembleRunner::runSeed(cfg.seed, run));
+        for (std::size_t s = 0; s < samples; ++s)
+        {
+            if (s > 0)
+            {
+                world.step(cfg.dt);
+            }
+            const double x = zombies ? world.zombieCount() : world.humanCount();
+            ref.stats[s].add(x);
+            ref.low[s].add(x);
+            ref.median[s].add(x);
+            ref.high[s].add(x);
+        }
+    }
+
+    EnsembleBand band;
+    for (std::size_t s = 0; s < samples; ++s)
+    {
+        band.mean.append(ref.stats[s].mean());
+        band.stddev.append(ref.stats[s].stddev());
+        band.low.append(ref.low[s].value());
+        band.median.append(ref.median[s].value());
+        band.high.append(ref.high[s].value());
+    }
+    return band;
+}
+
+bool sameBand(const EnsembleBand &a, const EnsembleBand &b)
+{
+    return a.mean == b.mean && a.stddev == b.stddev && a.low == b.low && a.median == b.median && a.high == b.high;
+}
+}
+
+int main()
+{
+    EnsembleConfig cfg;
+    cfg.runs = 24;
+    cfg.humans = 150;
+    cfg.zombies = 4;
+    cfg.steps = 60;
+    cfg.incubation = 0.5;
+    cfg.perception = 6.0;
+    cfg.seed = 77;
+
+    for (World::PursuitMode pursuit : {World::PursuitMode::Nearest, World::PursuitMode::FlowField})
+    {
+        cfg.pursuit = pursuit;
+        cfg.cellSize = pursuit == World::PursuitMode::Nearest ? 0.0 : 9.0;
+        const EnsembleBand humans = referenceBand(cfg, false);
+        const EnsembleBand zombies = referenceBand(cfg, true);
+        for (int threads : {1, 3, 8})
+        {
+            cfg.threads = threads;
+            int calls = 0;
+            const EnsembleResult result = EnsembleRunner(cfg).run([&calls](int, int) { ++calls; });
+            CHECK(calls == cfg.runs);
+            CHECK(result.runs == cfg.runs);
+            CHECK(result.time.size() == cfg.steps + 1);
+            CHECK(sameBand(result.humans, humans));
+            CHECK(sameBand(result.zombies, zombies));
+        }
+    }
+
+    // Один прогон — его собственный ряд без разброса.
+    cfg.runs = 1;
+    const EnsembleResult single = EnsembleRunner(cfg).run();
+    World world;
+    world.setDefaultBiteRadius(cfg.biteRadius);
+    world.setIncubationTime(cfg.incubation);
+    world.setPerceptionRadius(cfg.perception);
+    world.setPursuitMode(cfg.pursuit);
+    world.setGridCellSize(cfg.cellSize);
+    world.reset(cfg.humans, cfg.zombies, EnsembleRunner::runSeed(cfg.seed, 0));
+    bool same = true;
+    for (int s = 0; s <= cfg.steps; ++s)
+    {
+        if (s > 0)
+        {
+            world.step(cfg.dt);
+        }
+        same = same && single.humans.mean[s] == world.humanCount() && single.humans.stddev[s] == 0.0 &&
+               single.zombies.median[s] == world.zombieCount();
+    }
+    CHECK(same);
+
+    return testResult("test_ensemble");
+}
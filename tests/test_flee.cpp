@@ -0,0 +1,111 @@
+// Бегство: человек, у которого в обзоре есть зомби, бежит на своей скорости по сумме отталкиваний 1/d
+// от позиций начала шага; без зомби в обзоре (и при нулевом обзоре) он бродит как прежде.
+
+#include <cmath>
+#include <vector>
+
+#include "testing.h"
+#include "world.h"
+
+namespace
+{
+struct Start
+{
+    QPointF pos;
+    bool human;
+};
+
+// Позиции начала шага по id: шаг переставляет строки, id остаются.
+std::vector<Start> startOf(const World &world)
+{
+    const AgentStore &agents = world.agents();
+    std::vector<Start> start(agents.nextId());
+    for (AgentIndex i = 0; i < agents.size(); ++i)
+    {
+        start[agents.id(i)] = {agents.pos(i), agents.type(i) == ObjType::Human};
+    }
+    return start;
+}
+
+// Позиции по id после прогона: образ состояния не подходит, в нём записан и сам радиус обзора.
+std::vector<QPointF> run(double perception)
+{
+    World world;
+    world.setThreadCount(1);
+    world.setPerceptionRadius(perception);
+    world.reset(200, 20, 5);
+    for (int s = 0; s < 100; ++s)
+    {
+        world.step(0.1);
+    }
+    std::vector<QPointF> pos;
+    for (const Start &s : startOf(world))
+    {
+        pos.push_back(s.pos);
+    }
+    return pos;
+}
+}
+
+int main()
+{
+    const double perception = 15.0;
+    World world;
+    world.setThreadCount(1);
+    world.setPerceptionRadius(perception);
+    // Укушенные остаются людьми до конца прогона, чтобы id людей не меняли тип.
+    world.setIncubationTime(1e6);
+    world.reset(300, 30, 11);
+
+    const QRectF bounds = world.bounds();
+    int fleeing = 0;
+    for (int s = 0; s < 50; ++s)
+    {
+        const std::vector<Start> start = startOf(world);
+        world.step(0.1);
+
+        const AgentStore &agents = world.agents();
+        bool away = true;
+        bool atSpeed = true;
+        for (AgentIndex i = agents.typeBegin(ObjType::Human); i < agents.typeEnd(ObjType::Human); ++i)
+        {
+            const QPointF from = start[agents.id(i)].pos;
+            double awayX = 0.0;
+            double awayY = 0.0;
+            for (const Start &other : start)
+            {
+                const double dx = from.x() - other.pos.x();
+                const double dy = from.y() - other.pos.y();
+                const double d2 = dx * dx + dy * dy;
+                if (!other.human && d2 <= perception * perception && d2 > 1e-12)
+                {
+                    awayX += dx / d2;
+                    awayY += dy / d2;
+                }
+            }
+            const QPointF pos = agents.pos(i);
+            // У стены интегратор отражает скорость, направление бегства там не проверить.
+            const bool inside = pos.x() > bounds.left() && pos.x() < bounds.right() && pos.y() > bounds.top() &&
+                                pos.y() < bounds.bottom();
+            if (std::hypot(awayX, awayY) < 1e-6 || !inside)
+            {
+                continue;
+            }
+            ++fleeing;
+            const QPointF vel = agents.vel(i);
+            const double len = std::hypot(awayX, awayY);
+            const double cos = (vel.x() * awayX + vel.y() * awayY) / (std::hypot(vel.x(), vel.y()) * len);
+            away = away && cos > 1.0 - 1e-9;
+            atSpeed = atSpeed && std::abs(std::hypot(vel.x(), vel.y()) - agents.speed(i)) < 1e-9;
+        }
+        CHECK(away);
+        CHECK(atSpeed);
+    }
+    CHECK(fleeing > 0);
+
+    // Обзор, в который никто не попадает, ничего не меняет: прогон совпадает с прогоном без обзора.
+    CHECK(run(0.0) == run(1e-9));
+    CHECK(run(0.0) != run(perception));
+
+    return testResult("test_flee");
+}
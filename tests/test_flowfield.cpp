@@ -0,0 +1,131 @@
+// Поле преследования: родитель каждой ячейки — соседняя ячейка на шаг волны ближе к тому же источнику,
+// путь по родителям приходит в ячейку источника, а точки за границей мира, бесконечности и NaN
+// прижимаются к крайним ячейкам.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "counterrng.h"
+#include "flowfield.h"
+#include "testing.h"
+#include "world.h"
+
+namespace
+{
+// Ячейка, в которую попадает центр (x, y), по числу колонок и строк поля.
+std::size_t cellOf(const FlowField &field, const QRectF &bounds, double x, double y)
+{
+    const int col = static_cast<int>((x - bounds.left()) / bounds.width() * field.columns());
+    const int row = static_cast<int>((y - bounds.top()) / bounds.height() * field.rows());
+    return static_cast<std::size_t>(row) * field.columns() + col;
+}
+}
+
+int main()
+{
+    const QRectF bounds(0.0, 0.0, 300.0, 200.0);
+    FlowField field;
+    double wx = 0.0;
+    double wy = 0.0;
+    CHECK(field.source(10.0, 10.0) == FlowField::kNoSource);
+    CHECK(!field.waypoint(10.0, 10.0, wx, wy));
+
+    // Без источников: поле построено, но ни целей, ни направлений нет.
+    field.setCellSize(10.0);
+    field.build(bounds, nullptr, nullptr, nullptr, 0);
+    CHECK(field.source(10.0, 10.0) == FlowField::kNoSource);
+    CHECK(!field.waypoint(10.0, 10.0, wx, wy));
+
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<std::uint32_t> sources;
+    CounterRng rng(3, 0, 0);
+    for (std::uint32_t i = 0; i < 12; ++i)
+    {
+        xs.push_back(rng.nextDouble() * bounds.width());
+        ys.push_back(rng.nextDouble() * bounds.height());
+        sources.push_back(i);
+    }
+    field.build(bounds, xs.data(), ys.data(), sources.data(), sources.size());
+    CHECK(field.columns() == 30 && field.rows() == 20);
+
+    for (int row = 0; row < field.rows(); ++row)
+    {
+        for (int col = 0; col < field.columns(); ++col)
+        {
+            const double x = (col + 0.5) * 10.0;
+            const double y = (row + 0.5) * 10.0;
+            const std::uint32_t source = field.source(x, y);
+            const std::uint32_t distance = field.distance(x, y);
+            CHECK(source < xs.size());
+            CHECK(field.waypoint(x, y, wx, wy));
+            if (distance == 0)
+            {
+                CHECK(wx == x && wy == y);
+                CHECK(cellOf(field, bounds, xs[source], ys[source]) == cellOf(field, bounds, x, y));
+                continue;
+            }
+            // Родитель — один из восьми соседей, на шаг волны ближе, с тем же источником.
+            CHECK(std::abs(wx - x) <= 10.0 + 1e-9 && std::abs(wy - y) <= 10.0 + 1e-9);
+            CHECK(!(wx == x && wy == y));
+            CHECK(field.distance(wx, wy) + 1 == distance);
+            CHECK(field.source(wx, wy) == source);
+
+            // Путь по родителям за distance шагов приходит в ячейку источника.
+            double px = x;
+            double py = y;
+            for (std::uint32_t k = 0; k < distance; ++k)
+            {
+                field.waypoint(px, py, px, py);
+            }
+            CHECK(field.distance(px, py) == 0);
+            CHECK(cellOf(field, bounds, px, py) == cellOf(field, bounds, xs[source], ys[source]));
+        }
+    }
+
+    // Рядом с источником nearestSource находит сам источник (человек, уступивший ячейку соседу по
+    // ячейке, источником не считается).
+    for (std::uint32_t i = 0; i < xs.size(); ++i)
+    {
+        if (field.source(xs[i], ys[i]) != i)
+        {
+            continue;
+        }
+        const std::uint32_t near = field.nearestSource(xs[i] + 0.1, ys[i], xs.data(), ys.data());
+        CHECK(near != FlowField::kNoSource);
+        CHECK(std::hypot(xs[near] - xs[i] - 0.1, ys[near] - ys[i]) <= 0.1 + 1e-12);
+    }
+
+    // Точки вне мира и нечисла прижимаются к краю, а не дают неопределённое приведение к int.
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    CHECK(field.source(nan, nan) == field.source(0.0, 0.0));
+    CHECK(field.source(-1e300, 1e300) == field.source(0.0, 199.0));
+    CHECK(field.source(inf, -inf) == field.source(299.0, 0.0));
+    CHECK(field.distance(1e300, 1e300) == field.distance(299.0, 199.0));
+    CHECK(field.waypoint(nan, inf, wx, wy));
+
+    // В мире зомби по полю догоняют людей: у каждого зомби с целью есть точка, куда идти.
+    World world;
+    world.setThreadCount(1);
+    world.setPursuitMode(World::PursuitMode::FlowField);
+    world.reset(400, 10, 5);
+    const int zombies = world.zombieCount();
+    for (int s = 0; s < 400; ++s)
+    {
+        world.step(0.1);
+    }
+    CHECK(world.zombieCount() > zombies);
+    const AgentStore &agents = world.agents();
+    for (AgentIndex i = agents.typeBegin(ObjType::Zombie); i < agents.typeEnd(ObjType::Zombie); ++i)
+    {
+        const World::Pursuit p = world.pursuit(agents.pos(i));
+        CHECK(p.target.isValid() == (world.humanCount() > 0));
+        CHECK(!p.target || agents.type(p.target.index()) == ObjType::Human);
+    }
+
+    return testResult("test_flowfield");
+}
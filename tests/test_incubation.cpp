@@ -0,0 +1,67 @@
+// Инкубация: укушенный человек остаётся человеком со статусом Infected до своего срока и больше не
+// цель — ни ближайший человек, ни цель преследования, ни источник поля его не возвращают.
+
+#include "testing.h"
+#include "world.h"
+
+namespace
+{
+bool isInfected(const World &world, const AgentRef &ref)
+{
+    return ref && world.agents().status(ref.index()) == ObjStatus::Infected;
+}
+}
+
+int main()
+{
+    for (World::PursuitMode mode : {World::PursuitMode::Nearest, World::PursuitMode::FlowField})
+    {
+        World world;
+        world.setThreadCount(1);
+        world.setPursuitMode(mode);
+        // Срок намного длиннее прогона: заражённые копятся и не превращаются.
+        world.setIncubationTime(1e6);
+        world.reset(300, 40, 17);
+        const int zombies = world.zombieCount();
+
+        int bites = 0;
+        for (int s = 0; s < 300; ++s)
+        {
+            world.step(0.1);
+            bites += world.lastStepMetrics().bites;
+
+            const AgentStore &agents = world.agents();
+            bool clean = true;
+            for (AgentIndex i = agents.typeBegin(ObjType::Zombie); i < agents.typeEnd(ObjType::Zombie); ++i)
+            {
+                const QPointF pos = agents.pos(i);
+                clean = clean && !isInfected(world, world.pursuit(pos).target);
+                clean = clean && !isInfected(world, world.closestHuman(pos));
+            }
+            CHECK(clean);
+        }
+
+        CHECK(world.zombieCount() == zombies);
+        CHECK(world.infectedCount() > 0);
+        // Каждый засчитанный укус заражает нового человека: повторных укусов заражённых нет.
+        CHECK(world.infectedCount() == bites);
+
+        // Запрос в радиусе по людям и по сетке, и перебором видит только здоровых.
+        const AgentStore &agents = world.agents();
+        for (World::QueryMode query : {World::QueryMode::Grid, World::QueryMode::BruteForce})
+        {
+            world.setQueryMode(query);
+            std::vector<AgentIndex> found;
+            world.objectsInRadius(QPointF(0.0, 0.0), 1e9, ObjType::Human, found);
+            CHECK(static_cast<int>(found.size()) == world.humanCount() - world.infectedCount());
+            bool healthy = true;
+            for (AgentIndex i : found)
+            {
+                healthy = healthy && agents.status(i) != ObjStatus::Infected;
+            }
+            CHECK(healthy);
+        }
+    }
+
+    return testResult("test_incubation");
+}
@@ -0,0 +1,134 @@
+// Интегратор: AVX2, SSE2 и скалярный варианты дают побитово одинаковые позиции и скорости, в том
+// числе на NaN, ±0.0, ±inf и точно на границах, при любом хвосте пакета. Когда NaN и позиция, и v * dt,
+// знак и содержимое NaN результата не заданы (см. integrator.h): там проверяется только, что это NaN.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "integrator.h"
+#include "testing.h"
+
+namespace
+{
+std::uint64_t bits(double v)
+{
+    std::uint64_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+// nanPairs[i] — в строке i складываются два NaN: позиция и v * dt.
+bool sameBits(const std::vector<double> &a, const std::vector<double> &b, const std::vector<bool> &nanPairs = {})
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        const bool loose = i < nanPairs.size() && nanPairs[i];
+        if (loose ? !(std::isnan(a[i]) && std::isnan(b[i])) : bits(a[i]) != bits(b[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Result
+{
+    std::vector<double> out;
+    std::vector<double> vel;
+};
+
+Result run(integrator::Implementation implementation, const std::vector<double> &pos, std::vector<double> vel,
+           double lo, double hi, double dt)
+{
+    Result r;
+    r.out.assign(pos.size(), 12345.0);
+    integrator::advanceWith(implementation, {pos.data(), vel.data(), r.out.data(), lo, hi}, pos.size(), dt);
+    r.vel = vel;
+    return r;
+}
+}
+
+int main()
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double lo = 0.0;
+    const double hi = 100.0;
+    const std::vector<double> special = {nan, -nan, 0.0, -0.0, inf, -inf, lo, hi, std::nextafter(lo, -1.0),
+                                         std::nextafter(hi, 200.0), 50.0, -3.0, 103.0, 1e308, -1e308};
+
+    // Все пары (позиция, скорость) из особых значений, плюс сдвиг, чтобы хвосты пакетов были разными.
+    std::vector<double> pos;
+    std::vector<double> vel;
+    for (double p : special)
+    {
+        for (double v : special)
+        {
+            pos.push_back(p);
+            vel.push_back(v);
+        }
+    }
+    for (int k = 0; k < 37; ++k)
+    {
+        pos.push_back(-5.0 + 3.0 * k);
+        vel.push_back(k % 2 == 0 ? 40.0 : -40.0);
+    }
+
+    CHECK(integrator::isSupported(integrator::Implementation::Scalar));
+    const integrator::Implementation vectorized[] = {integrator::Implementation::Sse2,
+                                                     integrator::Implementation::Avx2};
+    for (double dt : {0.1, 1.0, 0.0, -0.5})
+    {
+        for (double bound : {0.0, -0.0})
+        {
+            for (std::size_t tail = 0; tail < 4; ++tail)
+            {
+                const std::vector<double> p(pos.begin(), pos.end() - static_cast<long>(tail));
+                const std::vector<double> v(vel.begin(), vel.end() - static_cast<long>(tail));
+                std::vector<bool> nanPairs(p.size());
+                for (std::size_t i = 0; i < p.size(); ++i)
+                {
+                    nanPairs[i] = std::isnan(p[i]) && std::isnan(v[i] * dt);
+                }
+                const Result reference = run(integrator::Implementation::Scalar, p, v, bound, hi, dt);
+                for (integrator::Implementation implementation : vectorized)
+                {
+                    if (!integrator::isSupported(implementation))
+                    {
+                        continue;
+                    }
+                    const Result r = run(implementation, p, v, bound, hi, dt);
+                    CHECK(sameBits(r.out, reference.out, nanPairs));
+                    CHECK(sameBits(r.vel, reference.vel));
+                }
+            }
+        }
+    }
+
+    // Скалярный вариант — это сама ветвистая семантика: прижать к стене и развернуть скорость.
+    const Result wall = run(integrator::Implementation::Scalar, {99.0, 1.0, 50.0}, {20.0, -20.0, 5.0}, lo, hi, 0.1);
+    CHECK(wall.out == std::vector<double>({100.0, 0.0, 50.5}));
+    CHECK(wall.vel == std::vector<double>({-20.0, 20.0, 5.0}));
+
+    // advance идёт через выбранный по процессору вариант и совпадает со скалярным.
+    std::vector<double> v = vel;
+    std::vector<double> out(pos.size());
+    integrator::advance({pos.data(), v.data(), out.data(), lo, hi}, pos.size(), 0.1);
+    const Result reference = run(integrator::Implementation::Scalar, pos, vel, lo, hi, 0.1);
+    std::vector<bool> nanPairs(pos.size());
+    for (std::size_t i = 0; i < pos.size(); ++i)
+    {
+        nanPairs[i] = std::isnan(pos[i]) && std::isnan(vel[i] * 0.1);
+    }
+    CHECK(sameBits(out, reference.out, nanPairs));
+    CHECK(sameBits(v, reference.vel));
+
+    return testResult("test_integrator");
+}
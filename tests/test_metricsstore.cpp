@@ -0,0 +1,112 @@
+// Хранилище сводок: строки читаются так же, как записаны, общие минимум и максимум совпадают
+// с пересчётом, а выборка для графика укладывается в бюджет и состоит из настоящих строк.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "counterrng.h"
+#include "metricsstore.h"
+#include "testing.h"
+
+namespace
+{
+constexpr double kStep = 0.25;
+
+// Каждая точка выборки — строка хранилища с тем же временем; время строк идёт не убывая.
+void checkQuery(const MetricsStore &store, MetricsStore::Column column, double t0, double t1, int maxPoints,
+                bool raw)
+{
+    QVector<double> times;
+    QVector<double> values;
+    store.query(column, t0, t1, maxPoints, times, values);
+    CHECK(times.size() == values.size());
+    CHECK(!times.isEmpty());
+    CHECK(times.size() <= std::max(maxPoints, 2) + 4);
+
+    for (int k = 0; k < times.size(); ++k)
+    {
+        const auto row = static_cast<std::size_t>(std::llround(times[k] / kStep));
+        CHECK(row < store.size());
+        CHECK(store.time(row) == times[k]);
+        CHECK(store.value(column, row) == values[k]);
+        CHECK(k == 0 || times[k - 1] <= times[k]);
+    }
+    // Сырая выборка захватывает по строке за каждым краем диапазона.
+    if (raw)
+    {
+        CHECK(times.first() < t0);
+        CHECK(times.last() > t1);
+    }
+}
+}
+
+int main()
+{
+    MetricsStore store;
+    CHECK(store.isEmpty());
+
+    // Больше одного куска строк и несколько групп верхнего уровня сводки.
+    const std::size_t rows = 3 * 4096 + 1234;
+    CounterRng rng(5, 0, 0);
+    std::vector<World::StepMetrics> reference;
+    for (std::size_t r = 0; r < rows; ++r)
+    {
+        World::StepMetrics m;
+        m.time = static_cast<double>(r) * kStep;
+        m.humans = static_cast<int>(rng.nextU64() % 100000);
+        m.zombies = static_cast<int>(rows - r);
+        m.infected = static_cast<int>(r % 17);
+        m.bites = static_cast<int>(rng.nextU64() % 50);
+        m.meanSpeed = rng.nextSigned() * 10.0;
+        m.meanTargetDistance = rng.nextDouble();
+        store.append(m);
+        reference.push_back(m);
+    }
+    CHECK(store.size() == rows);
+    CHECK(store.lastTime() == reference.back().time);
+
+    double lo = reference[0].meanSpeed;
+    double hi = lo;
+    int humansMax = 0;
+    for (std::size_t r = 0; r < rows; ++r)
+    {
+        CHECK(store.time(r) == reference[r].time);
+        CHECK(store.value(MetricsStore::Humans, r) == reference[r].humans);
+        CHECK(store.value(MetricsStore::Zombies, r) == reference[r].zombies);
+        CHECK(store.value(MetricsStore::MeanSpeed, r) == reference[r].meanSpeed);
+        lo = std::min(lo, reference[r].meanSpeed);
+        hi = std::max(hi, reference[r].meanSpeed);
+        humansMax = std::max(humansMax, reference[r].humans);
+    }
+    CHECK(store.min(MetricsStore::MeanSpeed) == lo);
+    CHECK(store.max(MetricsStore::MeanSpeed) == hi);
+    CHECK(store.min(MetricsStore::Zombies) == 1);
+    CHECK(store.max(MetricsStore::Zombies) == static_cast<double>(rows));
+    CHECK(store.max(MetricsStore::Humans) == humansMax);
+
+    // Узкое окно отдаётся сырыми строками, широкое — сводкой в пределах бюджета.
+    checkQuery(store, MetricsStore::MeanSpeed, 100.1, 110.1, 1000, true);
+    checkQuery(store, MetricsStore::MeanSpeed, 0.0, store.lastTime(), 400, false);
+    checkQuery(store, MetricsStore::Humans, 512.3, 3000.0, 64, false);
+    checkQuery(store, MetricsStore::Zombies, -50.0, 1e9, 2, false);
+
+    // Сводка по всему прогону сохраняет глобальные экстремумы.
+    QVector<double> times;
+    QVector<double> values;
+    store.query(MetricsStore::MeanSpeed, 0.0, store.lastTime(), 300, times, values);
+    CHECK(*std::min_element(values.begin(), values.end()) == lo);
+    CHECK(*std::max_element(values.begin(), values.end()) == hi);
+
+    // Пустой и перевёрнутый диапазоны.
+    store.query(MetricsStore::Humans, 10.0, 5.0, 100, times, values);
+    CHECK(times.isEmpty() && values.isEmpty());
+
+    store.clear();
+    CHECK(store.isEmpty());
+    store.query(MetricsStore::Humans, 0.0, 10.0, 100, times, values);
+    CHECK(times.isEmpty());
+
+    return testResult("test_metricsstore");
+}
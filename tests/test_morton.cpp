@@ -0,0 +1,132 @@
+// Порядок Мортона: sort даёт перестановку строк по неубыванию укороченного ключа, устойчиво и одинаково
+// с пулом и без, а перестановка строк мира не меняет судьбу ни одного агента.
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "counterrng.h"
+#include "mortonorder.h"
+#include "testing.h"
+#include "threadpool.h"
+#include "world.h"
+
+namespace
+{
+struct AgentState
+{
+    ObjType type;
+    ObjStatus status;
+    double x;
+    double y;
+};
+
+// Состояние агентов, индексированное по id.
+std::vector<AgentState> byId(const World &world)
+{
+    const AgentStore &agents = world.agents();
+    std::vector<AgentState> out(agents.nextId());
+    for (AgentIndex i = 0; i < agents.size(); ++i)
+    {
+        out[agents.id(i)] = {agents.type(i), agents.status(i), agents.pos(i).x(), agents.pos(i).y()};
+    }
+    return out;
+}
+
+bool sameStates(const std::vector<AgentState> &a, const std::vector<AgentState> &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i].type != b[i].type || a[i].status != b[i].status || a[i].x != b[i].x || a[i].y != b[i].y)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+int main()
+{
+    const QRectF bounds(-100.0, 50.0, 800.0, 600.0);
+
+    // Угловые точки и нечисла прижимаются к краям ключа.
+    CHECK(MortonOrder::key(-100.0, 50.0, bounds) == 0);
+    CHECK(MortonOrder::key(700.0, 650.0, bounds) == 0xFFFFFFFFu);
+    CHECK(MortonOrder::key(-1e300, 1e300, bounds) == 0xAAAAAAAAu);
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    CHECK(MortonOrder::key(nan, nan, bounds) == 0);
+
+    // Больше блока сортировки, чтобы с пулом сработала раздача по блокам.
+    const std::size_t n = 70000;
+    const std::size_t begin = 123;
+    std::vector<double> xs(begin + n);
+    std::vector<double> ys(begin + n);
+    CounterRng rng(9, 0, 0);
+    for (std::size_t i = 0; i < xs.size(); ++i)
+    {
+        xs[i] = bounds.left() + rng.nextDouble() * bounds.width();
+        ys[i] = bounds.top() + rng.nextDouble() * bounds.height();
+    }
+
+    ThreadPool pool(4);
+    MortonOrder morton;
+    for (int bits : {4, 7, 16})
+    {
+        std::vector<std::uint32_t> serial;
+        std::vector<std::uint32_t> parallel;
+        morton.sort(xs.data(), ys.data(), begin, begin + n, bounds, bits, nullptr, serial);
+        morton.sort(xs.data(), ys.data(), begin, begin + n, bounds, bits, &pool, parallel);
+        CHECK(serial == parallel);
+        CHECK(serial.size() == n);
+
+        std::vector<std::uint32_t> sorted = serial;
+        std::sort(sorted.begin(), sorted.end());
+        bool permutation = true;
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            permutation = permutation && sorted[k] == k;
+        }
+        CHECK(permutation);
+
+        const int drop = 2 * (16 - bits);
+        bool ordered = true;
+        for (std::size_t k = 1; k < n; ++k)
+        {
+            const std::size_t p = begin + serial[k - 1];
+            const std::size_t q = begin + serial[k];
+            const std::uint32_t a = MortonOrder::key(xs[p], ys[p], bounds) >> drop;
+            const std::uint32_t b = MortonOrder::key(xs[q], ys[q], bounds) >> drop;
+            ordered = ordered && (a < b || (a == b && serial[k - 1] < serial[k]));
+        }
+        CHECK(ordered);
+    }
+
+    // Мир с перестановкой строк и без неё: у каждого агента те же тип, статус и координаты. Обзор людей
+    // выключен: его сумма по соседям идёт в порядке строк и может разойтись в последнем бите.
+    World reordered;
+    World plain;
+    for (World *world : {&reordered, &plain})
+    {
+        world->setThreadCount(1);
+        world->setIncubationTime(0.5);
+        world->reset(6000, 300, 21);
+    }
+    plain.setSpatialReorder(false);
+    for (int s = 0; s < 120; ++s)
+    {
+        reordered.step(0.1);
+        plain.step(0.1);
+    }
+    CHECK(reordered.reorderInterval() > 0);
+    CHECK(reordered.zombieCount() == plain.zombieCount());
+    CHECK(reordered.infectedCount() == plain.infectedCount());
+    CHECK(sameStates(byId(reordered), byId(plain)));
+
+    return testResult("test_morton");
+}
@@ -0,0 +1,78 @@
+// Счётчики численности: приращения сходятся к тем же числам, что и пересчёт по столбцам хранилища,
+// на каждом шаге мира — с инкубацией, обзором людей и при нескольких потоках.
+
+#include "agentstore.h"
+#include "populationcounters.h"
+#include "testing.h"
+#include "world.h"
+
+namespace
+{
+PopulationCounters recount(const AgentStore &agents)
+{
+    PopulationCounters counters;
+    for (AgentIndex i = 0; i < agents.size(); ++i)
+    {
+        counters.add(agents.type(i), agents.status(i));
+    }
+    return counters;
+}
+
+bool sameCounts(const PopulationCounters &a, const PopulationCounters &b)
+{
+    for (ObjType type : {ObjType::Human, ObjType::Zombie})
+    {
+        for (ObjStatus status : {ObjStatus::Idle, ObjStatus::Moving, ObjStatus::Infected})
+        {
+            if (a.count(type, status) != b.count(type, status))
+            {
+                return false;
+            }
+        }
+    }
+    return a.total() == b.total();
+}
+}
+
+int main()
+{
+    PopulationCounters counters;
+    counters.add(ObjType::Human, ObjStatus::Idle, 5);
+    counters.move(ObjType::Human, ObjStatus::Idle, ObjType::Human, ObjStatus::Infected);
+    counters.move(ObjType::Human, ObjStatus::Infected, ObjType::Zombie, ObjStatus::Idle);
+    CHECK(counters.count(ObjType::Human) == 4);
+    CHECK(counters.count(ObjType::Zombie) == 1);
+    CHECK(counters.count(ObjStatus::Idle) == 5);
+    CHECK(counters.total() == 5);
+
+    // Приращения исполнителя могут быть отрицательными и складываются в общий счётчик.
+    PopulationCounters delta;
+    delta.move(ObjType::Human, ObjStatus::Idle, ObjType::Human, ObjStatus::Moving);
+    CHECK(delta.count(ObjType::Human, ObjStatus::Idle) == -1);
+    counters += delta;
+    CHECK(counters.count(ObjType::Human, ObjStatus::Moving) == 1);
+    CHECK(counters.count(ObjType::Human) == 4);
+
+    for (int threads : {1, 4})
+    {
+        World world;
+        world.setThreadCount(threads);
+        world.setIncubationTime(1.0);
+        world.setPerceptionRadius(8.0);
+        world.reset(3000, 100, 5);
+        bool consistent = sameCounts(world.counters(), recount(world.agents()));
+        for (int s = 0; s < 80; ++s)
+        {
+            world.step(0.1);
+            const PopulationCounters exact = recount(world.agents());
+            consistent = consistent && sameCounts(world.counters(), exact);
+            consistent = consistent && world.humanCount() == exact.count(ObjType::Human) &&
+                         world.zombieCount() == exact.count(ObjType::Zombie) &&
+                         world.infectedCount() == exact.count(ObjType::Human, ObjStatus::Infected);
+        }
+        CHECK(consistent);
+        CHECK(world.zombieCount() > 100);
+    }
+
+    return testResult("test_populationcounters");
+}
@@ -0,0 +1,139 @@
+// Сетка соседей против эталонного полного перебора (World::QueryMode::BruteForce): ближайший человек,
+// агенты в радиусе (все перегрузки) и пакетные запросы должны совпадать до слота.
+
+#include <QPointF>
+
+#include <algorithm>
+#include <vector>
+
+#include "counterrng.h"
+#include "testing.h"
+#include "world.h"
+
+namespace
+{
+struct Queries
+{
+    std::vector<QPointF> points;
+    std::vector<double> radii;
+};
+
+Queries makeQueries(const QRectF &b, std::uint64_t seed)
+{
+    Queries q;
+    for (std::uint64_t k = 0; k < 400; ++k)
+    {
+        // Часть точек лежит за границами мира: сетка прижимает их к крайним ячейкам.
+        CounterRng rng(seed, k, 1);
+        q.points.emplace_back(b.left() - 10.0 + rng.nextDouble() * (b.width() + 20.0),
+                              b.top() - 10.0 + rng.nextDouble() * (b.height() + 20.0));
+        q.radii.push_back(rng.nextDouble() * 25.0);
+    }
+    return q;
+}
+
+std::vector<AgentIndex> indicesOf(const std::vector<AgentRef> &refs)
+{
+    std::vector<AgentIndex> out;
+    for (const AgentRef &ref : refs)
+    {
+        out.push_back(ref.index());
+    }
+    return out;
+}
+
+void compareModes(World &world, std::uint64_t seed)
+{
+    const Queries q = makeQueries(world.bounds(), seed);
+    std::vector<AgentIndex> closest[2];
+    std::vector<std::vector<AgentIndex>> inRadius[2];
+    const World::QueryMode modes[2] = {World::QueryMode::Grid, World::QueryMode::BruteForce};
+    for (int m = 0; m < 2; ++m)
+    {
+        world.setQueryMode(modes[m]);
+        for (std::size_t k = 0; k < q.points.size(); ++k)
+        {
+            closest[m].push_back(world.closestHuman(q.points[k]).index());
+            for (ObjType type : {ObjType::Human, ObjType::Zombie})
+            {
+                inRadius[m].push_back(indicesOf(world.objectsInRadius(q.points[k], q.radii[k], type)));
+            }
+        }
+    }
+    CHECK(closest[0] == closest[1]);
+    CHECK(inRadius[0] == inRadius[1]);
+
+    // Буфер и посетитель дают тот же набор, что и возвращающая вектор перегрузка.
+    world.setQueryMode(World::QueryMode::Grid);
+    std::vector<AgentIndex> buffer;
+    std::vector<AgentIndex> visited;
+    for (std::size_t k = 0; k < q.points.size(); ++k)
+    {
+        world.objectsInRadius(q.points[k], q.radii[k], ObjType::Zombie, buffer);
+        CHECK(buffer == inRadius[1][2 * k + 1]);
+
+        visited.clear();
+        world.forEachInRadius(q.points[k], q.radii[k], ObjType::Zombie,
+                              [&visited](AgentIndex i) { visited.push_back(i); });
+        std::sort(visited.begin(), visited.end());
+        CHECK(visited == buffer);
+    }
+
+    // Пакеты в обоих режимах совпадают с одиночными запросами.
+    const double radius = 12.0;
+    for (World::QueryMode mode : modes)
+    {
+        world.setQueryMode(mode);
+        NeighborBatch batch;
+        world.objectsInRadius(q.points.data(), q.points.size(), radius, ObjType::Human, batch);
+        CHECK(batch.size() == q.points.size());
+        for (std::size_t k = 0; k < q.points.size(); ++k)
+        {
+            world.objectsInRadius(q.points[k], radius, ObjType::Human, buffer);
+            CHECK(std::vector<AgentIndex>(batch.begin(k), batch.end(k)) == buffer);
+        }
+
+        world.closestHumans(q.points.data(), q.points.size(), batch);
+        CHECK(batch.size() == q.points.size());
+        for (std::size_t k = 0; k < q.points.size(); ++k)
+        {
+            const AgentIndex expected = closest[1][k];
+            CHECK(batch.count(k) == (expected == kNoAgent ? 0u : 1u));
+            CHECK(batch.count(k) == 0 || *batch.begin(k) == expected);
+        }
+    }
+    world.setQueryMode(World::QueryMode::Grid);
+}
+}
+
+int main()
+{
+    struct Case
+    {
+        int humans;
+        int zombies;
+        double cell;
+        double incubation;
+    };
+    // Автоматический и заданный размер ячейки, пустые типы, заражённые люди (их запросы не видят).
+    const Case cases[] = {{300, 30, 0.0, 0.0}, {2000, 500, 0.0, 0.0}, {2000, 500, 7.5, 0.0},
+                          {0, 10, 0.0, 0.0}, {50, 0, 3.0, 0.0}, {1500, 300, 0.0, 1e6}};
+
+    std::uint64_t seed = 11;
+    for (const Case &c : cases)
+    {
+        World world;
+        world.setThreadCount(1);
+        world.setGridCellSize(c.cell);
+        world.setIncubationTime(c.incubation);
+        world.reset(c.humans, c.zombies, seed);
+        compareModes(world, seed);
+        for (int s = 0; s < 20; ++s)
+        {
+            world.step(0.1);
+        }
+        compareModes(world, seed + 1);
+        ++seed;
+    }
+    return testResult("test_queries");
+}
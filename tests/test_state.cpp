@@ -0,0 +1,81 @@
+// Образ состояния: восстановленный мир продолжает исходный побитово (в том числе с инкубацией, обзором
+// людей и перестановкой по кривой Мортона), ветви развилки с одинаковыми параметрами совпадают, а
+// повреждённый образ отвергается.
+
+#include <QByteArray>
+#include <QVector>
+
+#include "ensemble.h"
+
+#include "testing.h"
+#include "world.h"
+
+namespace
+{
+void configure(World &world, int threads)
+{
+    world.setThreadCount(threads);
+    world.setIncubationTime(1.5);
+    world.setPerceptionRadius(10.0);
+}
+
+void stepN(World &world, int steps)
+{
+    for (int s = 0; s < steps; ++s)
+    {
+        world.step(0.1);
+    }
+}
+}
+
+int main()
+{
+    // Больше kReorderMinAgents, чтобы перестановка строк успела сработать до и после снимка.
+    World origin;
+    configure(origin, 1);
+    origin.reset(5000, 400, 2024);
+    stepN(origin, 40);
+
+    const QByteArray image = origin.stateImage();
+    World restored;
+    CHECK(restored.restoreState(image));
+    restored.setThreadCount(1);
+    CHECK(restored.stateImage() == image);
+    CHECK(restored.incubationTime() == origin.incubationTime());
+    CHECK(restored.perceptionRadius() == origin.perceptionRadius());
+
+    stepN(origin, 60);
+    stepN(restored, 60);
+    CHECK(restored.stepIndex() == origin.stepIndex());
+    CHECK(restored.humanCount() == origin.humanCount());
+    CHECK(restored.infectedCount() == origin.infectedCount());
+    CHECK(restored.stateImage() == origin.stateImage());
+
+    // Развилка: ветвь с параметрами исходного мира повторяет его продолжение, одинаковые ветви совпадают.
+    World base;
+    configure(base, 1);
+    base.reset(2000, 100, 31);
+    stepN(base, 20);
+    const QVector<ForkBranch> branches = {{6.0, 0.1}, {12.0, 0.1}, {6.0, 0.1}};
+    const QVector<ForkResult> forks = ForkRunner(base, 30, 3).run(branches);
+    CHECK(forks.size() == branches.size());
+    for (const ForkResult &r : forks)
+    {
+        CHECK(r.restored);
+        CHECK(r.humans.size() == 31 && r.zombies.size() == 31 && r.time.size() == 31);
+    }
+    CHECK(forks[0].humans == forks[2].humans && forks[0].zombies == forks[2].zombies);
+    CHECK(forks[0].humans.first() == base.humanCount());
+    stepN(base, 30);
+    CHECK(forks[0].humans.last() == base.humanCount());
+    CHECK(forks[0].zombies.last() == base.zombieCount());
+
+    QByteArray broken = image;
+    broken[0] = 'X';
+    World rejected;
+    CHECK(!rejected.restoreState(broken));
+    CHECK(rejected.agents().size() == 0);
+    CHECK(!rejected.restoreState(image.left(image.size() - 1)));
+
+    return testResult("test_state");
+}
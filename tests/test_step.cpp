@@ -0,0 +1,95 @@
+// Параллельный шаг: пул раздаёт каждый индекс ровно один раз, а мир при любом числе потоков проходит
+// ту же траекторию, что и последовательный (случайность — по id агента и номеру шага, укусы и
+// превращения сводятся после прохода).
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "testing.h"
+#include "threadpool.h"
+#include "world.h"
+
+namespace
+{
+void checkPool(int threads)
+{
+    ThreadPool pool(threads);
+    CHECK(pool.threadCount() == threads);
+
+    const std::size_t count = 100003;
+    std::unique_ptr<std::atomic<int>[]> hits(new std::atomic<int>[count]);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        hits[i] = 0;
+    }
+    std::atomic<bool> badWorker{false};
+    pool.parallelFor(count, 1000, [&](std::size_t begin, std::size_t end, int worker) {
+        badWorker = badWorker || worker < 0 || worker >= threads;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            ++hits[i];
+        }
+    });
+    bool once = true;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        once = once && hits[i] == 1;
+    }
+    CHECK(once);
+    CHECK(!badWorker);
+
+    std::vector<std::atomic<int>> tasks(257);
+    pool.runTasks(tasks.size(), [&](std::size_t task, int) { ++tasks[task]; });
+    once = true;
+    for (const std::atomic<int> &t : tasks)
+    {
+        once = once && t == 1;
+    }
+    CHECK(once);
+}
+
+QByteArray run(int threads, int humans, int zombies, double incubation, double perception)
+{
+    World world;
+    world.setThreadCount(threads);
+    world.setIncubationTime(incubation);
+    world.setPerceptionRadius(perception);
+    world.reset(humans, zombies, 31);
+    int bites = 0;
+    for (int s = 0; s < 60; ++s)
+    {
+        world.step(0.1);
+        bites += world.lastStepMetrics().bites;
+    }
+    CHECK(bites > 0);
+    return world.stateImage();
+}
+}
+
+int main()
+{
+    for (int threads : {1, 2, 4, 7})
+    {
+        checkPool(threads);
+    }
+
+    struct Case
+    {
+        int humans;
+        int zombies;
+        double incubation;
+        double perception;
+    };
+    // Маленький мир проходит одним куском, большие — параллельно (и с перестановкой строк).
+    const Case cases[] = {{300, 30, 0.0, 0.0}, {6000, 300, 0.0, 0.0}, {6000, 300, 1.5, 10.0}};
+    for (const Case &c : cases)
+    {
+        const QByteArray sequential = run(1, c.humans, c.zombies, c.incubation, c.perception);
+        for (int threads : {2, 4, 7})
+        {
+            CHECK(run(threads, c.humans, c.zombies, c.incubation, c.perception) == sequential);
+        }
+    }
+    return testResult("test_step");
+}
@@ -0,0 +1,66 @@
+// Потоковые накопители против точных значений по всей выборке: Уэлфорд — с точностью округления,
+// P² — с допуском на приближение.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "counterrng.h"
+#include "streamingstats.h"
+#include "testing.h"
+
+int main()
+{
+    const std::size_t n = 100000;
+    std::vector<double> sample(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        // Несимметричное распределение, чтобы квантили не совпадали со средним.
+        CounterRng rng(3, i, 0);
+        const double u = rng.nextDouble();
+        sample[i] = u * u * 100.0;
+    }
+
+    RunningStats stats;
+    double sum = 0.0;
+    for (double x : sample)
+    {
+        stats.add(x);
+        sum += x;
+    }
+    const double mean = sum / n;
+    double m2 = 0.0;
+    for (double x : sample)
+    {
+        m2 += (x - mean) * (x - mean);
+    }
+    CHECK(stats.count() == n);
+    CHECK(std::abs(stats.mean() - mean) < 1e-9 * std::abs(mean));
+    CHECK(std::abs(stats.variance() - m2 / (n - 1)) < 1e-6 * (m2 / (n - 1)));
+    CHECK(stats.min() == *std::min_element(sample.begin(), sample.end()));
+    CHECK(stats.max() == *std::max_element(sample.begin(), sample.end()));
+
+    std::vector<double> sorted = sample;
+    std::sort(sorted.begin(), sorted.end());
+    for (double p : {0.05, 0.5, 0.95})
+    {
+        P2Quantile quantile(p);
+        for (double x : sample)
+        {
+            quantile.add(x);
+        }
+        const double exact = sorted[static_cast<std::size_t>(p * (n - 1))];
+        // Допуск — 1% размаха выборки.
+        CHECK(std::abs(quantile.value() - exact) < 1.0);
+    }
+
+    P2Quantile small(0.5);
+    for (double x : {3.0, 1.0, 2.0})
+    {
+        small.add(x);
+    }
+    CHECK(small.count() == 3);
+    CHECK(small.value() == 2.0);
+
+    return testResult("test_streamingstats");
+}
@@ -0,0 +1,62 @@
+// Колесо таймеров против прямого перебора: каждый ключ выходит ровно на своём шаге, включая сроки на
+// старших уровнях, перенос просроченных и ключи, запланированные на ходу.
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "counterrng.h"
+#include "testing.h"
+#include "timingwheel.h"
+
+int main()
+{
+    TimingWheel wheel;
+    wheel.clear(0);
+    std::multimap<std::uint64_t, std::uint32_t> expected;
+
+    std::uint32_t nextKey = 0;
+    const auto schedule = [&](std::uint64_t now, std::uint64_t due) {
+        wheel.schedule(nextKey, due);
+        expected.emplace(std::max(due, now + 1), nextKey);
+        ++nextKey;
+    };
+
+    // Сроки на всех трёх нижних уровнях (до 64^3 шагов) и один просроченный.
+    for (std::uint64_t k = 0; k < 2000; ++k)
+    {
+        CounterRng rng(5, k, 0);
+        schedule(0, 1 + static_cast<std::uint64_t>(rng.nextDouble() * 300000.0));
+    }
+    schedule(0, 0);
+    CHECK(wheel.size() == expected.size());
+
+    std::vector<std::uint32_t> due;
+    const std::uint64_t last = 300010;
+    for (std::uint64_t step = 1; step <= last; ++step)
+    {
+        due.clear();
+        wheel.advance(step, due);
+        std::sort(due.begin(), due.end());
+
+        std::vector<std::uint32_t> want;
+        const auto range = expected.equal_range(step);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            want.push_back(it->second);
+        }
+        std::sort(want.begin(), want.end());
+        CHECK(due == want);
+        expected.erase(range.first, range.second);
+
+        if (step % 997 == 0 && step + 5000 < last)
+        {
+            schedule(step, step + 1 + step % 5000);
+        }
+    }
+    CHECK(wheel.now() == last);
+    CHECK(expected.empty());
+    CHECK(wheel.empty());
+
+    return testResult("test_timingwheel");
+}
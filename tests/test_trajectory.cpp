@@ -0,0 +1,158 @@
+// Запись и чтение ZTRJ: позиции и типы каждого кадра восстанавливаются с точностью квантования при
+// переходе вперёд, назад и через ключевые кадры. Кадры, пропущенные из-за полной очереди, считаются,
+// а запись после пропуска читается с любого места.
+
+#include <QTemporaryDir>
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "testing.h"
+#include "trajectory.h"
+#include "world.h"
+
+namespace
+{
+struct Snapshot
+{
+    std::uint64_t step;
+    std::vector<double> x[kObjTypeCount];
+    std::vector<double> y[kObjTypeCount];
+};
+
+// Координаты агентов каждого типа в порядке id, как их отдаёт TrajectoryReader::positions.
+Snapshot snapshot(const World &world)
+{
+    const AgentStore &agents = world.agents();
+    std::vector<AgentIndex> byId(agents.nextId(), kNoAgent);
+    for (AgentIndex i = 0; i < agents.size(); ++i)
+    {
+        byId[agents.id(i)] = i;
+    }
+
+    Snapshot s;
+    s.step = world.stepIndex();
+    for (AgentIndex slot : byId)
+    {
+        const auto t = static_cast<std::size_t>(agents.type(slot));
+        s.x[t].push_back(agents.pos(slot).x());
+        s.y[t].push_back(agents.pos(slot).y());
+    }
+    return s;
+}
+
+// Каждый кадр записи совпадает с состоянием мира на своём шаге с точностью квантования.
+void checkFrames(TrajectoryReader &reader, const std::map<std::uint64_t, Snapshot> &byStep,
+                 const std::vector<int> &order)
+{
+    const QRectF b = reader.bounds();
+    const double tolX = b.width() / 65535.0;
+    const double tolY = b.height() / 65535.0;
+    std::vector<double> x;
+    std::vector<double> y;
+    for (int f : order)
+    {
+        CHECK(reader.seek(f));
+        const auto it = byStep.find(reader.frameStep(f));
+        CHECK(it != byStep.end());
+        if (it == byStep.end())
+        {
+            continue;
+        }
+        const Snapshot &expected = it->second;
+        for (ObjType type : {ObjType::Human, ObjType::Zombie})
+        {
+            const auto t = static_cast<std::size_t>(type);
+            reader.positions(type, x, y);
+            bool close = x.size() == expected.x[t].size();
+            for (std::size_t i = 0; close && i < x.size(); ++i)
+            {
+                close = std::abs(x[i] - expected.x[t][i]) <= tolX && std::abs(y[i] - expected.y[t][i]) <= tolY;
+            }
+            CHECK(close);
+        }
+    }
+}
+}
+
+int main()
+{
+    QTemporaryDir dir;
+    CHECK(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("run.ztrj"));
+
+    World world;
+    world.setThreadCount(1);
+    world.reset(300, 20, 99);
+
+    // Обычная запись: поток записи успевает за редкими кадрами небольшого мира.
+    const int keyframe = 8;
+    std::map<std::uint64_t, Snapshot> byStep;
+    std::uint64_t captured = 0;
+    TrajectoryRecorder recorder;
+    CHECK(recorder.open(path, world, keyframe));
+    CHECK(recorder.capture(world));
+    ++captured;
+    byStep[world.stepIndex()] = snapshot(world);
+    for (int s = 0; s < 60; ++s)
+    {
+        world.step(0.1);
+        CHECK(recorder.capture(world));
+        ++captured;
+        byStep[world.stepIndex()] = snapshot(world);
+    }
+    CHECK(recorder.close());
+
+    TrajectoryReader reader;
+    CHECK(reader.open(path));
+    CHECK(static_cast<std::uint64_t>(reader.frameCount()) + recorder.skippedFrames() == captured);
+    CHECK(reader.agentCount() == 320);
+    CHECK(reader.seed() == 99);
+    std::vector<int> order;
+    for (int f : {0, 1, 2, 9, 8, 7, 60, 33, 32, 31, 59, 16, 15, 0})
+    {
+        if (f < reader.frameCount())
+        {
+            order.push_back(f);
+        }
+    }
+    checkFrames(reader, byStep, order);
+    reader.close();
+
+    // Очереди сотни кадров подряд большого мира: поток записи отстаёт, capture() не ждёт его,
+    // а пропускает кадры. Шаги между пачками дают разные кадры; после пропуска пишется ключевой.
+    World crowd;
+    crowd.setThreadCount(1);
+    crowd.reset(30000, 200, 7);
+    byStep.clear();
+    captured = 0;
+    CHECK(recorder.open(path, crowd, keyframe));
+    for (int s = 0; s < 12; ++s)
+    {
+        crowd.step(0.1);
+        byStep[crowd.stepIndex()] = snapshot(crowd);
+        for (int k = 0; k < 128; ++k)
+        {
+            CHECK(recorder.capture(crowd));
+            ++captured;
+        }
+    }
+    CHECK(recorder.close());
+    CHECK(recorder.skippedFrames() > 0);
+
+    CHECK(reader.open(path));
+    CHECK(static_cast<std::uint64_t>(reader.frameCount()) + recorder.skippedFrames() == captured);
+    order.clear();
+    for (int f = reader.frameCount() - 1; f >= 0; f -= 3)
+    {
+        order.push_back(f);
+    }
+    for (int f = 0; f < reader.frameCount(); ++f)
+    {
+        order.push_back(f);
+    }
+    checkFrames(reader, byStep, order);
+
+    return testResult("test_trajectory");
+}
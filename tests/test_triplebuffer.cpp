@@ -0,0 +1,89 @@
+// Тройной буфер: читатель видит только целиком записанные снимки в порядке публикации, а слоты
+// std::vector после прогрева переписываются на месте, без новых выделений памяти.
+
+#include <atomic>
+#include <cstddef>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "testing.h"
+#include "triplebuffer.h"
+
+namespace
+{
+struct Frame
+{
+    long long step{-1};
+    std::vector<double> values;
+};
+
+constexpr std::size_t kValues = 4096;
+}
+
+int main()
+{
+    {
+        // Слоты без общего владения: после заполнения всех трёх новые адреса не появляются.
+        TripleBuffer<Frame> buffer;
+        std::set<const double *> storage;
+        for (int k = 0; k < 30; ++k)
+        {
+            Frame &frame = buffer.writeBuffer();
+            frame.step = k;
+            frame.values.assign(kValues, static_cast<double>(k));
+            buffer.publish();
+            if (k % 2 == 0 && buffer.update())
+            {
+                CHECK(buffer.readBuffer().step == k);
+            }
+            storage.insert(frame.values.data());
+        }
+        CHECK(storage.size() == 3);
+    }
+
+    {
+        // Писатель и читатель в разных потоках: снимок не рвётся, номера шагов только растут.
+        TripleBuffer<Frame> buffer;
+        constexpr long long kSteps = 20000;
+        std::atomic<bool> done{false};
+        std::thread writer([&] {
+            for (long long k = 0; k < kSteps; ++k)
+            {
+                Frame &frame = buffer.writeBuffer();
+                frame.step = k;
+                frame.values.assign(kValues, static_cast<double>(k));
+                buffer.publish();
+            }
+            done.store(true, std::memory_order_release);
+        });
+
+        long long last = -1;
+        long long reads = 0;
+        bool finished = false;
+        while (!finished)
+        {
+            finished = done.load(std::memory_order_acquire);
+            if (!buffer.update())
+            {
+                continue;
+            }
+            const Frame &frame = buffer.readBuffer();
+            CHECK(frame.step > last);
+            CHECK(frame.values.size() == kValues);
+            bool whole = true;
+            for (double v : frame.values)
+            {
+                whole = whole && v == static_cast<double>(frame.step);
+            }
+            CHECK(whole);
+            last = frame.step;
+            ++reads;
+        }
+        writer.join();
+        CHECK(last == kSteps - 1);
+        CHECK(reads > 0);
+    }
+
+    return testResult("test_triplebuffer");
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdio>
+
+// Проверки без тестового фреймворка: провал печатается в stderr и учитывается в коде возврата main.
+inline int g_failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) не выполнено\n", __FILE__, __LINE__, #cond);                        \
+            ++g_failures;                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+inline int testResult(const char *name)
+{
+    if (g_failures > 0)
+    {
+        std::fprintf(stderr, "%s: %d проверок не выполнено\n", name, g_failures);
+        return 1;
+    }
+    return 0;
+}